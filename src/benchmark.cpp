@@ -0,0 +1,361 @@
+#include "huffman_encoder.h"
+#include "perf_counter.h"
+#include <string>
+#include <iostream>
+#include <random>
+#include <functional>
+#include <chrono>
+#include <cmath>
+
+//usage: benchmark [max_sz = 64MiB] [min_sz = 64]
+//       benchmark perf [sz = 16MiB] - hardware counters per phase, unavailable counters come out as null
+//one JSON object per line on stdout - sizes double from min_sz up to max_sz (1GiB needs ~8GiB of memory)
+
+template <class Executable>
+auto timeit(Executable exe) -> size_t{
+
+    using namespace std::chrono;
+    auto s = high_resolution_clock::now();
+    exe();
+    auto l = duration_cast<nanoseconds>(high_resolution_clock::now() - s).count();
+
+    return l;
+}
+
+//repeats exe until TARGET_BYTES have gone through it, so small buffers are not dominated by clock resolution
+template <class Executable>
+auto throughput(size_t sz, Executable exe) -> double{
+
+    constexpr size_t TARGET_BYTES   = size_t{1} << 24;
+    constexpr size_t MAX_ROUNDS     = size_t{1} << 16;
+    auto rounds                     = std::clamp(TARGET_BYTES / std::max(sz, size_t{1}), size_t{1}, MAX_ROUNDS);
+    auto ns                         = timeit([&]{
+        for (size_t i = 0; i < rounds; ++i){
+            exe();
+        }
+    });
+
+    return static_cast<double>(sz) * rounds / std::max(ns, size_t{1}) * 1e9 / (1u << 20);
+}
+
+auto uniform_buf(const size_t N) -> std::unique_ptr<char[]>{
+
+    static auto rand_dev    = std::bind(std::uniform_int_distribution<int>{0, std::numeric_limits<unsigned char>::max()}, std::mt19937{});
+    auto buf                = std::unique_ptr<char[]>(new char[N]);
+    std::generate(buf.get(), buf.get() + N, [&]{return static_cast<char>(rand_dev());});
+
+    return buf;
+}
+
+auto zipf_buf(const size_t N) -> std::unique_ptr<char[]>{
+
+    constexpr double S  = 1.1;
+    auto weight         = std::vector<double>(256);
+
+    for (size_t i = 0; i < weight.size(); ++i){
+        weight[i] = 1.0 / std::pow(static_cast<double>(i + 1), S);
+    }
+
+    static auto rand_gen    = std::mt19937{};
+    auto dist               = std::discrete_distribution<int>(weight.begin(), weight.end());
+    auto buf                = std::unique_ptr<char[]>(new char[N]);
+    std::generate(buf.get(), buf.get() + N, [&]{return static_cast<char>(dist(rand_gen));});
+
+    return buf;
+}
+
+//zipf-distributed words over a fixed vocabulary, separated by spaces and the odd punctuation
+auto text_buf(const size_t N) -> std::unique_ptr<char[]>{
+
+    constexpr size_t VOCABULARY_SZ  = 4096;
+    static auto rand_gen            = std::mt19937{};
+    auto letter                     = std::discrete_distribution<int>({8.2, 1.5, 2.8, 4.3, 12.7, 2.2, 2.0, 6.1, 7.0, 0.2, 0.8, 4.0, 2.4, 6.7, 7.5, 1.9, 0.1, 6.0, 6.3, 9.1, 2.8, 1.0, 2.4, 0.2, 2.0, 0.1});
+    auto word_len                   = std::uniform_int_distribution<size_t>(1u, 10u);
+    auto vocabulary                 = std::vector<std::string>(VOCABULARY_SZ);
+    auto weight                     = std::vector<double>(VOCABULARY_SZ);
+
+    for (size_t i = 0; i < VOCABULARY_SZ; ++i){
+        vocabulary[i]   = std::string(word_len(rand_gen), ' ');
+        weight[i]       = 1.0 / static_cast<double>(i + 1);
+        std::generate(vocabulary[i].begin(), vocabulary[i].end(), [&]{return static_cast<char>('a' + letter(rand_gen));});
+    }
+
+    auto word       = std::discrete_distribution<size_t>(weight.begin(), weight.end());
+    auto separator  = std::discrete_distribution<int>({90, 5, 3, 2});
+    auto buf        = std::unique_ptr<char[]>(new char[N]);
+
+    for (size_t i = 0; i < N;){
+        const auto& w = vocabulary[word(rand_gen)];
+
+        for (size_t j = 0; j < w.size() && i < N; ++j){
+            buf[i++] = w[j];
+        }
+
+        if (i < N){
+            buf[i++] = " ,.\n"[separator(rand_gen)];
+        }
+    }
+
+    return buf;
+}
+
+auto skewed_buf(const size_t N) -> std::unique_ptr<char[]>{
+
+    static auto rand_dev    = std::bind(std::geometric_distribution<int>{0.5}, std::mt19937{});
+    auto buf                = std::unique_ptr<char[]>(new char[N]);
+    std::generate(buf.get(), buf.get() + N, [&]{return static_cast<char>(rand_dev());});
+
+    return buf;
+}
+
+auto make_buf(const std::string& dist, size_t N) -> std::unique_ptr<char[]>{
+
+    if (dist == "uniform"){
+        return uniform_buf(N);
+    }
+
+    if (dist == "zipf"){
+        return zipf_buf(N);
+    }
+
+    if (dist == "text"){
+        return text_buf(N);
+    }
+
+    return skewed_buf(N);
+}
+
+template <size_t ALPHABET_SIZE>
+void bench_spawn(const std::string& dist, const char * buf, size_t sz){
+
+    using namespace dg::huffman_encoder;
+    constexpr size_t ROUNDS = 16;
+
+    auto counter        = user_interface::count<ALPHABET_SIZE>(buf, sz);
+    auto tree           = model::Tree{};
+    auto delim_tree     = model::Tree{};
+    auto build_ns       = size_t{0u};
+    auto delim_ns       = size_t{0u};
+    auto encode_ns      = size_t{0u};
+    auto decode_ns      = size_t{0u};
+    auto spawn_ns       = size_t{0u};
+    auto spawn_enc_ns   = size_t{0u};
+    auto spawn_dec_ns   = size_t{0u};
+    auto view_ns        = size_t{0u};
+
+    for (size_t i = 0; i < ROUNDS; ++i){
+        build_ns    += timeit([&]{tree = make::build<ALPHABET_SIZE>(make::clamp(counter), constants::DEFAULT_MAX_CODE_LENGTH);});
+        delim_ns    += timeit([&]{delim_tree = make::to_delim_tree<ALPHABET_SIZE>(tree, false);});
+        encode_ns   += timeit([&]{make::encode_dictionarize<ALPHABET_SIZE>(delim_tree); make::find_delim<ALPHABET_SIZE>(delim_tree);});
+        decode_ns   += timeit([&]{make::decode_dictionarize<ALPHABET_SIZE>(delim_tree); make::to_canonical_table(delim_tree);});
+        spawn_ns    += timeit([&]{user_interface::spawn_fast_engine<ALPHABET_SIZE>(tree);});
+        spawn_enc_ns += timeit([&]{user_interface::spawn_encode_engine<ALPHABET_SIZE>(tree);});
+        spawn_dec_ns += timeit([&]{user_interface::spawn_decode_engine<ALPHABET_SIZE>(tree)->prepare();});
+    }
+
+    auto engine = user_interface::spawn_fast_engine<ALPHABET_SIZE>(tree);
+    auto image  = engine->get_image();
+    auto enc_sz = user_interface::spawn_encode_engine<ALPHABET_SIZE>(tree)->get_image().second;
+    auto dec_sz = user_interface::spawn_decode_engine<ALPHABET_SIZE>(tree)->get_image().second;
+    auto model  = dg::compact_serializer::serialize(user_interface::to_compact_model<ALPHABET_SIZE>(tree));
+
+    for (size_t i = 0; i < ROUNDS; ++i){
+        view_ns     += timeit([&]{user_interface::spawn_fast_engine_view<ALPHABET_SIZE>(image.first, image.second);});
+    }
+
+    std::cout << "{\"bench\":\"spawn\",\"dist\":\"" << dist << "\",\"width\":" << ALPHABET_SIZE * CHAR_BIT
+              << ",\"build_us\":"           << build_ns / ROUNDS / 1000
+              << ",\"to_delim_tree_us\":"   << delim_ns / ROUNDS / 1000
+              << ",\"encode_dict_us\":"     << encode_ns / ROUNDS / 1000
+              << ",\"decode_dict_us\":"     << decode_ns / ROUNDS / 1000
+              << ",\"spawn_us\":"           << spawn_ns / ROUNDS / 1000
+              << ",\"spawn_encode_us\":"    << spawn_enc_ns / ROUNDS / 1000
+              << ",\"spawn_decode_us\":"    << spawn_dec_ns / ROUNDS / 1000
+              << ",\"image_view_us\":"      << view_ns / ROUNDS / 1000
+              << ",\"engine_bytes\":"       << image.second
+              << ",\"encode_engine_bytes\":" << enc_sz
+              << ",\"decode_engine_bytes\":" << dec_sz
+              << ",\"model_bytes\":"        << model.second << "}" << std::endl;
+}
+
+template <size_t ALPHABET_SIZE>
+void bench_codec(const std::string& dist, const dg::huffman_encoder::core::FastEngine<ALPHABET_SIZE>& engine, const char * buf, size_t sz){
+
+    using namespace dg::huffman_encoder;
+
+    auto enc_sz     = engine.encoded_size(buf, sz);
+    auto enc_buf    = std::unique_ptr<char[]>(new char[enc_sz + bit_stream::read_padd_requirement()]);
+    auto dec_buf    = std::unique_ptr<char[]>(new char[sz + constants::DECODE_ENTRY_BYTE_CAP]);
+    auto rdbuf      = types::bit_array_type{};
+
+    auto encode_mb_s        = throughput(sz, [&]{engine.encode_into(buf, sz, enc_buf.get(), rdbuf);});
+    auto fast_decode_mb_s   = throughput(sz, [&]{engine.fast_decode_into(enc_buf.get(), 0u, enc_sz * CHAR_BIT, dec_buf.get());});
+    auto decode_mb_s        = throughput(sz, [&]{engine.decode_into(enc_buf.get(), 0u, dec_buf.get());});
+    auto checked_mb_s       = throughput(sz, [&]{engine.checked_decode_into(enc_buf.get(), enc_sz, dec_buf.get(), sz);});
+
+    if (std::memcmp(buf, dec_buf.get(), sz) != 0){
+        std::cerr << "mismatch: " << dist << " " << sz << std::endl;
+        std::abort();
+    }
+
+    std::cout << "{\"bench\":\"codec\",\"dist\":\"" << dist << "\",\"width\":" << ALPHABET_SIZE * CHAR_BIT
+              << ",\"size\":"                   << sz
+              << ",\"ratio\":"                  << static_cast<double>(enc_sz) / std::max(sz, size_t{1})
+              << ",\"encode_into_mb_s\":"       << encode_mb_s
+              << ",\"fast_decode_into_mb_s\":"  << fast_decode_mb_s
+              << ",\"decode_into_mb_s\":"       << decode_mb_s
+              << ",\"checked_decode_into_mb_s\":" << checked_mb_s << "}" << std::endl;
+}
+
+//rows of COLUMN_SZ fields with one engine per field, the shape RowEncodingEngine is meant for
+void bench_row(const std::string& dist, const char * train_buf, size_t train_sz, const char * buf, size_t sz){
+
+    using namespace dg::huffman_encoder;
+    constexpr size_t COLUMN_SZ      = 4;
+    constexpr size_t FIELD_SZ[]     = {8, 16, 31, 64};
+    constexpr size_t ROW_SZ         = 8 + 16 + 31 + 64;
+
+    auto engines = std::vector<core::AnyFastEngine>{};
+
+    for (size_t i = 0; i < COLUMN_SZ; ++i){
+        if (i % 2 == 0){
+            engines.push_back(user_interface::spawn_fast_engine<1>(user_interface::build<1>(user_interface::count<1>(train_buf, train_sz))));
+        } else{
+            engines.push_back(user_interface::spawn_fast_engine<2>(user_interface::build<2>(user_interface::count<2>(train_buf, train_sz))));
+        }
+    }
+
+    auto row_engine = user_interface::spawn_row_engine(std::move(engines));
+    auto row_count  = sz / ROW_SZ;
+    auto fields     = std::vector<std::vector<std::pair<const char *, size_t>>>(row_count);
+
+    for (size_t i = 0; i < row_count; ++i){
+        auto offs = i * ROW_SZ;
+
+        for (size_t j = 0; j < COLUMN_SZ; ++j){
+            fields[i].push_back({buf + offs, FIELD_SZ[j]});
+            offs += FIELD_SZ[j];
+        }
+    }
+
+    auto enc_offs = std::vector<size_t>(row_count + 1, size_t{0u});
+
+    for (size_t i = 0; i < row_count; ++i){
+        enc_offs[i + 1] = enc_offs[i] + row_engine->encoded_size(fields[i]);
+    }
+
+    auto enc_buf    = std::unique_ptr<char[]>(new char[enc_offs.back() + bit_stream::read_padd_requirement()]);
+    auto dec_buf    = std::unique_ptr<char[]>(new char[ROW_SZ]);
+    auto dec_fields = std::vector<std::pair<char *, size_t>>(COLUMN_SZ, {dec_buf.get(), 0u});
+
+    auto encode_mb_s = throughput(row_count * ROW_SZ, [&]{
+        for (size_t i = 0; i < row_count; ++i){
+            row_engine->encode_into(fields[i], enc_buf.get() + enc_offs[i]);
+        }
+    });
+
+    auto decode_mb_s = throughput(row_count * ROW_SZ, [&]{
+        for (size_t i = 0; i < row_count; ++i){
+            for (size_t j = 0, offs = 0; j < COLUMN_SZ; offs += FIELD_SZ[j++]){
+                dec_fields[j].first = dec_buf.get() + offs;
+            }
+
+            row_engine->decode_into(enc_buf.get() + enc_offs[i], dec_fields);
+        }
+    });
+
+    std::cout << "{\"bench\":\"row\",\"dist\":\"" << dist << "\",\"width\":\"mixed\""
+              << ",\"size\":"               << row_count * ROW_SZ
+              << ",\"rows\":"               << row_count
+              << ",\"ratio\":"              << static_cast<double>(enc_offs.back()) / std::max(row_count * ROW_SZ, size_t{1})
+              << ",\"encode_into_mb_s\":"   << encode_mb_s
+              << ",\"decode_into_mb_s\":"   << decode_mb_s << "}" << std::endl;
+}
+
+void print_per_byte(const char * name, const dg::perf_counter::Sample& sample, size_t sz, size_t event, double scale){
+
+    std::cout << ",\"" << name << "\":";
+
+    if (sample.is_available[event]){
+        std::cout << static_cast<double>(sample.value[event]) / std::max(sz, size_t{1}) * scale;
+    } else{
+        std::cout << "null";
+    }
+}
+
+void print_perf(const std::string& dist, size_t width, const char * phase, size_t sz, const dg::perf_counter::Sample& sample){
+
+    using namespace dg::perf_counter;
+
+    std::cout << "{\"bench\":\"perf\",\"dist\":\"" << dist << "\",\"width\":" << width << ",\"phase\":\"" << phase << "\",\"size\":" << sz;
+    print_per_byte("cycles_per_byte", sample, sz, CYCLES, 1.0);
+    print_per_byte("instructions_per_byte", sample, sz, INSTRUCTIONS, 1.0);
+    print_per_byte("cache_misses_per_kb", sample, sz, CACHE_MISSES, 1024.0);
+    print_per_byte("branch_misses_per_kb", sample, sz, BRANCH_MISSES, 1024.0);
+    print_per_byte("ns_per_byte", sample, sz, TASK_CLOCK, 1.0);
+    std::cout << "}" << std::endl;
+}
+
+//table decode is fast_decode_into, tree decode is decode_into - the per-bit walk fast_decode_into falls back to
+template <size_t ALPHABET_SIZE>
+void bench_perf(const std::string& dist, const char * train_buf, size_t train_sz, const char * buf, size_t sz){
+
+    using namespace dg::huffman_encoder;
+
+    auto group      = dg::perf_counter::CounterGroup{};
+    auto counter    = std::vector<size_t>{};
+    auto tree       = model::Tree{};
+    auto engine     = std::unique_ptr<core::FastEngine<ALPHABET_SIZE>>{};
+    auto width      = ALPHABET_SIZE * CHAR_BIT;
+
+    print_perf(dist, width, "count", train_sz, group.measure([&]{counter = user_interface::count<ALPHABET_SIZE>(train_buf, train_sz);}));
+    print_perf(dist, width, "build", train_sz, group.measure([&]{tree = user_interface::build<ALPHABET_SIZE>(counter); engine = user_interface::spawn_fast_engine<ALPHABET_SIZE>(tree);}));
+
+    auto enc_sz     = engine->encoded_size(buf, sz);
+    auto enc_buf    = std::unique_ptr<char[]>(new char[enc_sz + bit_stream::read_padd_requirement()]);
+    auto dec_buf    = std::unique_ptr<char[]>(new char[sz + constants::DECODE_ENTRY_BYTE_CAP]);
+    auto rdbuf      = types::bit_array_type{};
+
+    print_perf(dist, width, "encode", sz, group.measure([&]{engine->encode_into(buf, sz, enc_buf.get(), rdbuf);}));
+    print_perf(dist, width, "table_decode", sz, group.measure([&]{engine->fast_decode_into(enc_buf.get(), 0u, enc_sz * CHAR_BIT, dec_buf.get());}));
+    print_perf(dist, width, "tree_decode", sz, group.measure([&]{engine->decode_into(enc_buf.get(), 0u, dec_buf.get());}));
+}
+
+int main(int argc, char * argv[]){
+
+    if (argc > 1 && std::string(argv[1]) == "perf"){
+        const size_t TRAIN_SZ   = size_t{1} << 20;
+        const size_t SZ         = (argc > 2) ? std::stoull(argv[2]) : size_t{1} << 24;
+
+        for (const auto& dist: {"uniform", "zipf", "text", "skewed"}){
+            auto train  = make_buf(dist, TRAIN_SZ);
+            auto buf    = make_buf(dist, SZ);
+            bench_perf<1>(dist, train.get(), TRAIN_SZ, buf.get(), SZ);
+            bench_perf<2>(dist, train.get(), TRAIN_SZ, buf.get(), SZ);
+        }
+
+        return 0;
+    }
+
+    const size_t TRAIN_SZ   = size_t{1} << 20;
+    const size_t ROW_SZ     = size_t{1} << 20;
+    const size_t MAX_SZ     = (argc > 1) ? std::stoull(argv[1]) : size_t{1} << 26;
+    const size_t MIN_SZ     = (argc > 2) ? std::stoull(argv[2]) : size_t{64};
+
+    for (const auto& dist: {"uniform", "zipf", "text", "skewed"}){
+        auto train      = make_buf(dist, TRAIN_SZ);
+        auto buf        = make_buf(dist, MAX_SZ);
+        auto narrow     = dg::huffman_encoder::user_interface::spawn_fast_engine<1>(dg::huffman_encoder::user_interface::build<1>(dg::huffman_encoder::user_interface::count<1>(train.get(), TRAIN_SZ)));
+        auto wide       = dg::huffman_encoder::user_interface::spawn_fast_engine<2>(dg::huffman_encoder::user_interface::build<2>(dg::huffman_encoder::user_interface::count<2>(train.get(), TRAIN_SZ)));
+
+        bench_spawn<1>(dist, train.get(), TRAIN_SZ);
+        bench_spawn<2>(dist, train.get(), TRAIN_SZ);
+
+        for (size_t sz = MIN_SZ; sz <= MAX_SZ; sz *= 2){
+            bench_codec<1>(dist, *narrow, buf.get(), sz);
+            bench_codec<2>(dist, *wide, buf.get(), sz);
+        }
+
+        bench_row(dist, train.get(), TRAIN_SZ, buf.get(), std::min(ROW_SZ, MAX_SZ));
+    }
+}
@@ -0,0 +1,317 @@
+#ifndef __DG_HUFFMAN_DICTIONARY__
+#define __DG_HUFFMAN_DICTIONARY__
+
+#include "huffman_encoder.h"
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+//trained dictionaries for many small messages - every message names its dictionary by a stable 32-bit id, and the
+//registry resolves ids to engines through an LRU cache, so neither side sets anything up per message
+
+namespace dg::huffman_encoder::runtime_exception{
+
+    struct UnknownDictionaryError: std::exception{};
+    struct DictionaryIdConflictError: std::exception{};
+}
+
+namespace dg::huffman_encoder::dictionary{
+
+    using dictionary_id_type = uint32_t;
+
+    static inline constexpr size_t DEFAULT_CACHE_SZ     = 64;   //engines kept built - a 16-bit engine image is about 2MB
+    static inline constexpr size_t MAX_VARINT_SZ        = 10;
+    static inline constexpr size_t MAX_HEADER_SZ        = sizeof(dictionary_id_type) + MAX_VARINT_SZ;
+
+    struct Dictionary{
+        uint8_t alphabet_sz;
+        model::CodeLengthModel model;
+
+        template <class Reflector>
+        void dg_reflect(const Reflector& reflector) const{
+            reflector(alphabet_sz, model);
+        }
+
+        template <class Reflector>
+        void dg_reflect(const Reflector& reflector){
+            reflector(alphabet_sz, model);
+        }
+    };
+
+    inline auto operator ==(const Dictionary& lhs, const Dictionary& rhs) noexcept -> bool{
+
+        return lhs.alphabet_sz == rhs.alphabet_sz && lhs.model.encoding == rhs.model.encoding && lhs.model.payload == rhs.model.payload;
+    }
+
+    //one histogram over every sample - samples are counted separately, so symbols never straddle two of them
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto train(const std::vector<std::pair<const char *, size_t>>& corpus, size_t max_code_length = constants::DEFAULT_MAX_CODE_LENGTH) -> Dictionary{
+
+        auto counter = make::make_histogram_counter<ALPHABET_SIZE>();
+
+        for (const auto& [buf, sz]: corpus){
+            make::count_into<ALPHABET_SIZE>(buf, sz, counter);
+        }
+
+        make::flush<ALPHABET_SIZE>(counter);
+        auto tree = user_interface::build<ALPHABET_SIZE>(std::move(counter.total), max_code_length);
+
+        return Dictionary{static_cast<uint8_t>(ALPHABET_SIZE), user_interface::to_compact_model<ALPHABET_SIZE>(tree)};
+    }
+
+    //hash of the serialized dictionary - the same dictionary gets the same id in every process
+    inline auto id_of(const Dictionary& dict) -> dictionary_id_type{
+
+        auto [buf, sz]  = dg::compact_serializer::serialize(dict);
+        auto hashed     = dg::compact_serializer::utility::hash(buf.get(), sz);
+
+        return static_cast<dictionary_id_type>(hashed ^ (hashed >> 32));
+    }
+
+    //message: dictionary_id_type id | LEB128 decoded size | payload
+    //the payload is one FastEngine message, or the input itself when that would not shrink - a payload whose byte size
+    //equals the decoded size is stored, as in frames
+
+    constexpr auto max_message_size(size_t inp_sz) -> size_t{
+
+        return MAX_HEADER_SZ + inp_sz;
+    }
+
+    inline auto write_header(char * op_buf, dictionary_id_type id, size_t decoded_sz) noexcept -> char *{
+
+        op_buf = dg::compact_serializer::core::serialize(id, op_buf);
+
+        while (decoded_sz >= 0x80u){
+            *op_buf++   = static_cast<char>(decoded_sz | 0x80u);
+            decoded_sz  >>= 7;
+        }
+
+        *op_buf++ = static_cast<char>(decoded_sz);
+        return op_buf;
+    }
+
+    struct Header{
+        dictionary_id_type id;
+        size_t decoded_sz;
+        size_t header_sz;
+    };
+
+    inline auto read_header(const char * inp_buf, size_t inp_sz) -> Header{
+
+        using runtime_exception::CorruptedError;
+
+        if (inp_sz < sizeof(dictionary_id_type) + 1u){
+            throw CorruptedError{};
+        }
+
+        auto rs = Header{};
+        dg::compact_serializer::core::deserialize(inp_buf, rs.id);
+
+        for (size_t i = sizeof(dictionary_id_type), shift = 0u; ; ++i, shift += 7){
+            if (i == inp_sz || shift >= std::numeric_limits<size_t>::digits){
+                throw CorruptedError{};
+            }
+
+            auto byte       = static_cast<uint8_t>(inp_buf[i]);
+            rs.decoded_sz   |= static_cast<size_t>(byte & 0x7Fu) << shift;
+
+            if ((byte & 0x80u) == 0u){
+                rs.header_sz = i + 1u;
+                break;
+            }
+        }
+
+        if (inp_sz - rs.header_sz > rs.decoded_sz){
+            throw CorruptedError{};
+        }
+
+        return rs;
+    }
+
+    //thread-safe; engines are built outside the lock, so a miss on one id does not stall lookups of others
+    class Registry{
+
+        private:
+
+            using AnyEngine = std::variant<std::shared_ptr<const core::FastEngine<1u>>, std::shared_ptr<const core::FastEngine<2u>>>;
+
+            struct CacheEntry{
+                dictionary_id_type id;
+                AnyEngine engine;
+            };
+
+            mutable std::mutex mtx;
+            std::unordered_map<dictionary_id_type, Dictionary> dictionary;
+            mutable std::list<CacheEntry> lru; //most recently used first
+            mutable std::unordered_map<dictionary_id_type, std::list<CacheEntry>::iterator> cache;
+            size_t cache_sz;
+            memory::ImageAllocator * allocator;
+
+        public:
+
+            //the allocator backs every cached engine and must outlive the registry
+            Registry(size_t cache_sz,
+                     memory::ImageAllocator& allocator): mtx(),
+                                                         dictionary(),
+                                                         lru(),
+                                                         cache(),
+                                                         cache_sz(cache_sz),
+                                                         allocator(&allocator){}
+
+            Registry(const Registry&) = delete;
+            Registry& operator =(const Registry&) = delete;
+
+            //an id names one dictionary for good - registering a different dictionary under a taken id throws DictionaryIdConflictError,
+            //which add(Dictionary) can hit on a 32-bit hash collision - pick another id and pass it to add(id, dict)
+            void add(dictionary_id_type id, Dictionary dict){
+
+                if (dict.alphabet_sz != 1u && dict.alphabet_sz != 2u){
+                    throw runtime_exception::CorruptedError{};
+                }
+
+                auto lck_grd        = std::lock_guard<std::mutex>(this->mtx);
+                auto [it, is_new]   = this->dictionary.try_emplace(id, std::move(dict)); //leaves dict alone if id is taken
+
+                if (!is_new && !(it->second == dict)){
+                    throw runtime_exception::DictionaryIdConflictError{};
+                }
+            }
+
+            auto add(Dictionary dict) -> dictionary_id_type{
+
+                auto id = id_of(dict);
+                this->add(id, std::move(dict));
+
+                return id;
+            }
+
+            auto contains(dictionary_id_type id) const -> bool{
+
+                auto lck_grd = std::lock_guard<std::mutex>(this->mtx);
+                return this->dictionary.contains(id);
+            }
+
+            //op_buf must hold max_message_size(inp_sz)
+            auto encode_into(dictionary_id_type id, const char * inp_buf, size_t inp_sz, char * op_buf) const -> char *{
+
+                auto any_engine  = this->get_engine(id);
+                op_buf          = write_header(op_buf, id, inp_sz);
+
+                return std::visit([&](const auto& engine){
+                    if (engine->encoded_size(inp_buf, inp_sz) >= inp_sz){
+                        std::memcpy(op_buf, inp_buf, inp_sz);
+                        return op_buf + inp_sz;
+                    }
+
+                    auto rdbuf = types::bit_array_type{};
+                    return engine->encode_into(inp_buf, inp_sz, op_buf, rdbuf);
+                }, any_engine);
+            }
+
+            auto encode(dictionary_id_type id, const char * inp_buf, size_t inp_sz) const -> std::pair<std::unique_ptr<char[]>, size_t>{
+
+                auto buf    = std::unique_ptr<char[]>(new char[max_message_size(inp_sz)]);
+                auto last   = this->encode_into(id, inp_buf, inp_sz, buf.get());
+
+                return {std::move(buf), static_cast<size_t>(std::distance(buf.get(), last))};
+            }
+
+            //validates the whole message - throws CorruptedError, OutputOverflowError or UnknownDictionaryError
+            auto decode_into(const char * inp_buf, size_t inp_sz, char * op_buf, size_t op_cap) const -> char *{
+
+                auto header     = read_header(inp_buf, inp_sz);
+                auto any_engine = this->get_engine(header.id);
+                auto payload    = inp_buf + header.header_sz;
+                auto payload_sz = inp_sz - header.header_sz;
+
+                if (header.decoded_sz > op_cap){
+                    throw runtime_exception::OutputOverflowError{};
+                }
+
+                if (payload_sz == header.decoded_sz){
+                    std::memcpy(op_buf, payload, payload_sz);
+                    return op_buf + payload_sz;
+                }
+
+                auto [ilast, olast] = std::visit([&](const auto& engine){return engine->checked_decode_into(payload, payload_sz, op_buf, header.decoded_sz);}, any_engine);
+
+                if (ilast != inp_buf + inp_sz || olast != op_buf + header.decoded_sz){
+                    throw runtime_exception::CorruptedError{};
+                }
+
+                return olast;
+            }
+
+            auto decode(const char * inp_buf, size_t inp_sz) const -> std::pair<std::unique_ptr<char[]>, size_t>{
+
+                auto decoded_sz = read_header(inp_buf, inp_sz).decoded_sz;
+                auto buf        = std::unique_ptr<char[]>(new char[decoded_sz]);
+                this->decode_into(inp_buf, inp_sz, buf.get(), decoded_sz);
+
+                return {std::move(buf), decoded_sz};
+            }
+
+        private:
+
+            auto get_engine(dictionary_id_type id) const -> AnyEngine{
+
+                auto dict = Dictionary{};
+
+                {
+                    auto lck_grd = std::lock_guard<std::mutex>(this->mtx);
+
+                    if (auto it = this->cache.find(id); it != this->cache.end()){
+                        this->lru.splice(this->lru.begin(), this->lru, it->second);
+                        return it->second->engine;
+                    }
+
+                    auto it = this->dictionary.find(id);
+
+                    if (it == this->dictionary.end()){
+                        throw runtime_exception::UnknownDictionaryError{};
+                    }
+
+                    dict = it->second;
+                }
+
+                auto rs             = this->spawn_engine(dict);
+                auto lck_grd        = std::lock_guard<std::mutex>(this->mtx);
+                auto [it, is_new]   = this->cache.emplace(id, this->lru.end());
+
+                if (!is_new){
+                    this->lru.splice(this->lru.begin(), this->lru, it->second); //built concurrently by another thread - keep theirs
+                    return it->second->engine;
+                }
+
+                this->lru.push_front(CacheEntry{id, rs});
+                it->second = this->lru.begin();
+
+                if (this->lru.size() > this->cache_sz){
+                    this->cache.erase(this->lru.back().id);
+                    this->lru.pop_back();
+                }
+
+                return rs;
+            }
+
+            auto spawn_engine(const Dictionary& dict) const -> AnyEngine{
+
+                if (dict.alphabet_sz == 1u){
+                    return std::shared_ptr<const core::FastEngine<1u>>(user_interface::spawn_fast_engine<1u>(dict.model, false, *this->allocator));
+                }
+
+                return std::shared_ptr<const core::FastEngine<2u>>(user_interface::spawn_fast_engine<2u>(dict.model, false, *this->allocator));
+            }
+    };
+
+    inline auto spawn_registry(size_t cache_sz = DEFAULT_CACHE_SZ, memory::ImageAllocator& allocator = memory::default_allocator()) -> std::unique_ptr<Registry>{
+
+        if (cache_sz == 0u){
+            std::abort();
+        }
+
+        return std::make_unique<Registry>(cache_sz, allocator);
+    }
+}
+
+#endif
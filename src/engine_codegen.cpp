@@ -0,0 +1,122 @@
+#include "huffman_encoder.h"
+#include "engine_image.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+//compiles a fixed model into a C++ header - see engine_image::write_header
+//
+//  engine_codegen <8|16> <namespace> sample <file> [max_code_length] [rle] > engine.h
+//  engine_codegen <8|16> <namespace> histogram <file> [max_code_length] [rle] > engine.h
+//  engine_codegen <8|16> <namespace> model <file> [rle] > engine.h
+//
+//sample counts the symbols of a file, histogram reads one whitespace-separated count per symbol in symbol order,
+//model reads a serialized model::CodeLengthModel - rle is 0 or 1
+
+auto read_file(const std::string& path) -> std::vector<char>{
+
+    auto is = std::ifstream(path, std::ios::binary);
+
+    if (!is){
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    return std::vector<char>(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+auto to_size(const std::string& arg, const std::string& name) -> size_t{
+
+    auto pos    = size_t{0u};
+    auto rs     = size_t{0u};
+
+    try{
+        rs = std::stoull(arg, &pos);
+    } catch (const std::logic_error&){
+        pos = 0u;
+    }
+
+    if (pos == 0u || pos != arg.size()){
+        throw std::invalid_argument(name + " must be a non-negative integer, got " + arg);
+    }
+
+    return rs;
+}
+
+template <size_t ALPHABET_SIZE>
+auto read_tree(const std::string& mode, const std::string& path, size_t max_code_length) -> dg::huffman_encoder::model::Tree{
+
+    using namespace dg::huffman_encoder;
+
+    if (mode == "sample"){
+        auto buf = read_file(path);
+        return user_interface::build<ALPHABET_SIZE>(user_interface::count<ALPHABET_SIZE>(buf.data(), buf.size()), max_code_length);
+    }
+
+    if (mode == "histogram"){
+        auto is         = std::ifstream(path);
+        auto counter    = std::vector<size_t>(constants::DICT_SIZE<ALPHABET_SIZE>);
+
+        if (!is){
+            throw std::runtime_error("cannot open " + path);
+        }
+
+        for (auto& e: counter){
+            if (!(is >> e)){
+                throw std::runtime_error(path + ": expected " + std::to_string(counter.size()) + " counts");
+            }
+        }
+
+        return user_interface::build<ALPHABET_SIZE>(std::move(counter), max_code_length);
+    }
+
+    if (mode == "model"){
+        auto buf = read_file(path);
+        return user_interface::from_compact_model<ALPHABET_SIZE>(dg::compact_serializer::deserialize<model::CodeLengthModel>(buf.data(), buf.size()));
+    }
+
+    throw std::invalid_argument("unknown input " + mode);
+}
+
+template <size_t ALPHABET_SIZE>
+void generate(const std::string& ns, const std::string& mode, const std::string& path, size_t max_code_length, bool rle_escape){
+
+    using namespace dg::huffman_encoder;
+
+    auto engine = user_interface::spawn_fast_engine<ALPHABET_SIZE>(read_tree<ALPHABET_SIZE>(mode, path, max_code_length), rle_escape);
+    engine_image::write_header(*engine, ns, std::cout);
+}
+
+int main(int argc, char * argv[]){
+
+    if (argc < 5){
+        std::cerr << "usage: " << argv[0] << " <8|16> <namespace> sample|histogram <file> [max_code_length] [rle]" << std::endl
+                  << "       " << argv[0] << " <8|16> <namespace> model <file> [rle]" << std::endl;
+        return 1;
+    }
+
+    try{
+        const auto width            = std::string(argv[1]);
+        const auto ns               = std::string(argv[2]);
+        const auto mode             = std::string(argv[3]);
+        const auto path             = std::string(argv[4]);
+        const auto rle_idx          = (mode == "model") ? 5 : 6;
+        const auto max_code_length  = (mode != "model" && argc > 5) ? to_size(argv[5], "max_code_length") : dg::huffman_encoder::constants::DEFAULT_MAX_CODE_LENGTH;
+        const auto rle_escape       = argc > rle_idx && std::string(argv[rle_idx]) == "1";
+
+        if (width == "8"){
+            generate<1>(ns, mode, path, max_code_length, rle_escape);
+        } else if (width == "16"){
+            generate<2>(ns, mode, path, max_code_length, rle_escape);
+        } else{
+            throw std::invalid_argument("width must be 8 or 16");
+        }
+    } catch (const std::exception& e){
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
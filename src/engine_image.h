@@ -0,0 +1,255 @@
+#ifndef __DG_HUFFMAN_ENGINE_IMAGE__
+#define __DG_HUFFMAN_ENGINE_IMAGE__
+
+#include "huffman_encoder.h"
+#include <string>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <bit>
+#include <cctype>
+#include <cstdio>
+#include <system_error>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//POSIX loader/saver for engine images - every process mapping the same file shares one page cache copy of the tables
+//a huge page allocator for engine images built in process, and a C++ header writer that compiles an image into static data
+
+namespace dg::huffman_encoder::engine_image{
+
+    struct FileCloser{
+        
+        void operator()(int * fd) const noexcept{
+
+            ::close(*fd);
+            delete fd;
+        }
+    };
+
+    static auto open_file(const std::string& path, int flag, mode_t mode = 0) -> std::unique_ptr<int, FileCloser>{
+
+        auto fd = ::open(path.c_str(), flag, mode);
+
+        if (fd == -1){
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+
+        return std::unique_ptr<int, FileCloser>(new int(fd));
+    }
+
+    static auto file_size(int fd, const std::string& path) -> size_t{
+
+        struct stat st{};
+
+        if (::fstat(fd, &st) == -1){
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+
+        if (st.st_size == 0){
+            throw dg::compact_serializer::runtime_exception::CorruptedError{};
+        }
+
+        return static_cast<size_t>(st.st_size);
+    }
+
+    //2MB page arena for engine images - images are packed into shared chunks, so the tables of several engines sit
+    //under one TLB entry; a chunk is unmapped once the allocator and every engine in it are gone
+    //MAP_HUGETLB needs reserved pages (vm.nr_hugepages), otherwise the chunk is aligned anonymous memory advised
+    //with MADV_HUGEPAGE, which transparent huge pages back in "always" or "madvise" mode
+    class HugePageAllocator: public memory::ImageAllocator{
+
+        private:
+
+            std::mutex mtx;
+            std::shared_ptr<char> chunk;
+            size_t chunk_sz;
+            size_t used;
+
+        public:
+
+            static inline constexpr size_t HUGE_PAGE_SZ = size_t{1} << 21;
+
+            HugePageAllocator(): mtx(),
+                                 chunk(),
+                                 chunk_sz(0u),
+                                 used(0u){}
+
+            auto allocate(size_t sz) -> std::shared_ptr<char> override{
+
+                auto lck_grd    = std::lock_guard<std::mutex>(this->mtx);
+                auto offs       = image::align(this->used);
+
+                if (this->chunk == nullptr || offs > this->chunk_sz || sz > this->chunk_sz - offs){
+                    this->chunk_sz  = std::max((sz + HUGE_PAGE_SZ - 1) / HUGE_PAGE_SZ, size_t{1}) * HUGE_PAGE_SZ;
+                    this->chunk     = map_chunk(this->chunk_sz);
+                    offs            = 0u;
+                }
+
+                this->used = offs + sz;
+                return std::shared_ptr<char>(this->chunk, this->chunk.get() + offs);
+            }
+
+        private:
+
+            static auto map_chunk(size_t sz) -> std::shared_ptr<char>{
+
+#ifdef MAP_HUGETLB
+                auto addr = ::mmap(nullptr, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+                if (addr != MAP_FAILED){
+                    return std::shared_ptr<char>(static_cast<char *>(addr), [sz](char * addr) noexcept{::munmap(addr, sz);});
+                }
+#endif
+                //over-map by a page and trim both ends to a HUGE_PAGE_SZ-aligned range
+                auto raw_sz = sz + HUGE_PAGE_SZ;
+                auto raw    = ::mmap(nullptr, raw_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+                if (raw == MAP_FAILED){
+                    throw std::bad_alloc{};
+                }
+
+                auto head_sz    = (HUGE_PAGE_SZ - reinterpret_cast<uintptr_t>(raw) % HUGE_PAGE_SZ) % HUGE_PAGE_SZ;
+                auto first      = static_cast<char *>(raw) + head_sz;
+                auto tail_sz    = raw_sz - head_sz - sz;
+
+                if (head_sz != 0u){
+                    ::munmap(raw, head_sz);
+                }
+
+                if (tail_sz != 0u){
+                    ::munmap(first + sz, tail_sz);
+                }
+
+#ifdef MADV_HUGEPAGE
+                ::madvise(first, sz, MADV_HUGEPAGE); //advisory - on failure the chunk stays on base pages
+#endif
+                return std::shared_ptr<char>(first, [sz](char * addr) noexcept{::munmap(addr, sz);});
+            }
+    };
+
+    template <size_t ALPHABET_SIZE>
+    void save(const core::FastEngine<ALPHABET_SIZE>& engine, const std::string& path){
+
+        auto [image, image_sz]  = engine.get_image();
+        auto fd                 = open_file(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        while (image_sz != 0u){
+            auto written = ::write(*fd, image, image_sz);
+
+            if (written == -1){
+                if (errno == EINTR){
+                    continue;
+                }
+
+                throw std::system_error(errno, std::generic_category(), path);
+            }
+
+            image       += written;
+            image_sz    -= written;
+        }
+    }
+
+    //emits a header that embeds the image as an aligned constexpr array and defines ns::engine(), a FastEngine view over it,
+    //so a fixed model costs nothing at runtime - the tables live in .rodata and are read in place
+    //the header pins the image format version and the byte order of the generating host
+    template <size_t ALPHABET_SIZE>
+    void write_header(const core::FastEngine<ALPHABET_SIZE>& engine, const std::string& ns, std::ostream& os){
+
+        static constexpr size_t BYTE_PER_LINE = 64;
+
+        auto [image, image_sz]  = engine.get_image();
+        auto guard              = std::string("__");
+
+        for (char c: ns){
+            guard += std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : '_';
+        }
+
+        guard += "_ENGINE_IMAGE__";
+
+        os << "#ifndef " << guard << "\n"
+           << "#define " << guard << "\n\n"
+           << "//generated by engine_codegen - do not edit\n"
+           << "//" << ALPHABET_SIZE * CHAR_BIT << "-bit symbols, " << image_sz << " bytes\n\n"
+           << "#include \"huffman_encoder.h\"\n"
+           << "#include <bit>\n\n"
+           << "namespace " << ns << "{\n\n"
+           << "    static_assert(dg::huffman_encoder::image::VERSION == " << image::VERSION << "u, \"engine image format changed - regenerate\");\n"
+           << "    static_assert(std::endian::native == std::endian::" << (std::endian::native == std::endian::little ? "little" : "big") << ", \"engine image generated for the other byte order\");\n\n"
+           << "    inline constexpr size_t ALPHABET_SIZE = " << ALPHABET_SIZE << ";\n\n"
+           << "    //string literal initializer - compilers parse it far faster than an initializer list of the same size\n"
+           << "    alignas(dg::huffman_encoder::image::SECTION_ALIGNMENT) inline constexpr char IMAGE[" << image_sz + 1 << "] =";
+
+        //every byte is escaped, so an octal escape always ends at the next backslash or quote and needs no padding
+        for (size_t i = 0; i < image_sz; ++i){
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\%o", static_cast<unsigned int>(static_cast<unsigned char>(image[i])));
+            os << ((i % BYTE_PER_LINE == 0u) ? "\n        \"" : "") << buf << ((i % BYTE_PER_LINE == BYTE_PER_LINE - 1 || i + 1 == image_sz) ? "\"" : "");
+        }
+
+        os << ";\n\n"
+           << "    inline auto engine() -> const dg::huffman_encoder::core::FastEngine<ALPHABET_SIZE>&{\n\n"
+           << "        static const auto rs = dg::huffman_encoder::core::FastEngine<ALPHABET_SIZE>(nullptr, IMAGE);\n"
+           << "        return rs;\n"
+           << "    }\n"
+           << "}\n\n"
+           << "#endif\n";
+    }
+
+    //read-only shared mapping - the engine keeps the mapping alive
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto load(const std::string& path, bool verify_checksum = true) -> std::unique_ptr<core::FastEngine<ALPHABET_SIZE>>{
+
+        auto fd         = open_file(path, O_RDONLY);
+        auto image_sz   = file_size(*fd, path);
+        auto addr       = ::mmap(nullptr, image_sz, PROT_READ, MAP_SHARED, *fd, 0);
+
+        if (addr == MAP_FAILED){
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+
+        auto storage    = std::shared_ptr<const void>(addr, [image_sz](const void * addr) noexcept{::munmap(const_cast<void *>(addr), image_sz);});
+        auto image      = static_cast<const char *>(addr);
+        image::verify<ALPHABET_SIZE>(image, image_sz, verify_checksum);
+
+        return std::make_unique<core::FastEngine<ALPHABET_SIZE>>(std::move(storage), image);
+    }
+
+    //private copy in allocator memory instead of a shared mapping - e.g. to put a saved engine on huge pages
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto load(const std::string& path, memory::ImageAllocator& allocator, bool verify_checksum = true) -> std::unique_ptr<core::FastEngine<ALPHABET_SIZE>>{
+
+        auto fd         = open_file(path, O_RDONLY);
+        auto image_sz   = file_size(*fd, path);
+        auto storage    = allocator.allocate(image_sz);
+
+        for (size_t read_sz = 0u; read_sz != image_sz;){
+            auto rs = ::read(*fd, storage.get() + read_sz, image_sz - read_sz);
+
+            if (rs == -1){
+                if (errno == EINTR){
+                    continue;
+                }
+
+                throw std::system_error(errno, std::generic_category(), path);
+            }
+
+            if (rs == 0){
+                throw dg::compact_serializer::runtime_exception::CorruptedError{};
+            }
+
+            read_sz += rs;
+        }
+
+        auto image = storage.get();
+        image::verify<ALPHABET_SIZE>(image, image_sz, verify_checksum);
+
+        return std::make_unique<core::FastEngine<ALPHABET_SIZE>>(std::move(storage), image);
+    }
+}
+
+#endif
@@ -10,34 +10,74 @@
 #include <iterator>
 #include <cstring>
 #include <iostream>
+#include <exception>
+#include <variant>
 #include "serialization.h"
+#include "thread_pool.h"
 #include <array>
 #include "assert.h"
-#include <deque>
+#include <span>
+#include <new>
+#include <mutex>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define DG_HUFFMAN_ENCODER_X86_KERNEL
+#endif
 
 namespace dg::huffman_encoder::constants{
 
-    static inline constexpr size_t ALPHABET_SIZE            = 2;
-    static inline constexpr size_t ALPHABET_BIT_SIZE        = ALPHABET_SIZE * CHAR_BIT;
-    static inline constexpr size_t DICT_SIZE                = size_t{1} << ALPHABET_BIT_SIZE;
+    static inline constexpr size_t DEFAULT_ALPHABET_SIZE    = 2;
+    static inline constexpr size_t MAX_ALPHABET_SIZE        = 2;
     static inline constexpr size_t MAX_ENCODING_SZ_PER_BYTE = 6;
-    static inline constexpr size_t MAX_DECODING_SZ_PER_BYTE = ALPHABET_SIZE * CHAR_BIT;
+    static inline constexpr size_t MAX_DECODING_SZ_PER_BYTE = MAX_ALPHABET_SIZE * CHAR_BIT;    //engines without an rle escape only
+    static inline constexpr size_t RLE_MIN_REPEAT_SZ        = 16;   //shorter repeats are always coded symbol by symbol
+    static inline constexpr size_t ENCODE_KERNEL_TAIL_SZ    = 64;   //symbols left to stream_to, so the kernel's word stores stay within the message
+    static inline constexpr size_t ENCODE_PAIR_MAX_LENGTH   = 28;   //two codes plus 7 pending bits must fit one bit_container_type
+    static inline constexpr size_t PACKED_ENCODE_MAX_LENGTH = 26;   //longest code a model::EncodeEntry holds, next to its 6-bit length
+    static inline constexpr size_t MAX_CODE_LENGTH          = 32;
+    static inline constexpr size_t DEFAULT_MAX_CODE_LENGTH  = 24;
+    static inline constexpr size_t DECODE_TABLE_BIT_SIZE    = 12;
+    static inline constexpr size_t DECODE_TABLE_SIZE        = size_t{1} << DECODE_TABLE_BIT_SIZE;
+    static inline constexpr size_t DECODE_ENTRY_BYTE_CAP    = 6;
+    static inline constexpr size_t INTERLEAVED_LANE_SZ      = 4;
+    static inline constexpr size_t MAX_INTERLEAVED_LANE_SZ  = 8;
+    static inline constexpr size_t DEFAULT_FRAME_BLOCK_SZ   = size_t{1} << 20;
+    static inline constexpr size_t DEFAULT_WIDE_MIN_GAIN    = 10;   //percent the 16-bit engine must save over the 8-bit one before a block is encoded wide
+    static inline constexpr size_t COUNT_BLOCK_SZ           = size_t{1} << 16;
+    static inline constexpr size_t COUNT_FLUSH_CYCLE_SZ     = std::numeric_limits<uint32_t>::max();
+    static inline constexpr uint8_t RLE_CODE_LENGTH         = 0;
+    static inline constexpr uint8_t NIBBLE_CODE_LENGTH      = 1;
     static inline constexpr bool L                          = false;
     static inline constexpr bool R                          = true;
+
+    //symbol width in bytes - 1 gives 256-entry tables, 2 gives 65536-entry tables
+    template <size_t ALPHABET_SIZE>
+    static inline constexpr size_t ALPHABET_BIT_SIZE        = ALPHABET_SIZE * CHAR_BIT;
+
+    template <size_t ALPHABET_SIZE>
+    static inline constexpr size_t DICT_SIZE                = size_t{1} << ALPHABET_BIT_SIZE<ALPHABET_SIZE>;
 }
 
 namespace dg::huffman_encoder::types{
     
     using bit_container_type    = uint64_t;
     using bit_array_type        = std::pair<bit_container_type, size_t>;
-    using word_type             = std::array<char, constants::ALPHABET_SIZE>;
-    using num_rep_type          = std::conditional_t<constants::ALPHABET_SIZE == 1u, 
+    using word_type             = std::array<char, constants::MAX_ALPHABET_SIZE>; //only the leading ALPHABET_SIZE bytes are used
+
+    template <size_t ALPHABET_SIZE>
+    using num_rep_type          = std::conditional_t<ALPHABET_SIZE == 1u, 
                                                      uint8_t,
-                                                     std::conditional_t<constants::ALPHABET_SIZE == 2u, 
+                                                     std::conditional_t<ALPHABET_SIZE == 2u, 
                                                                         uint16_t,
                                                                         void>>;
 } 
 
+namespace dg::huffman_encoder::runtime_exception{
+
+    using CorruptedError = dg::compact_serializer::runtime_exception::CorruptedError;
+    struct OutputOverflowError: std::exception{};
+}
+
 namespace dg::huffman_encoder::precond{
 
     static_assert(dg::compact_serializer::constants::endianness == std::endian::little);
@@ -65,12 +105,121 @@ namespace dg::huffman_encoder::model{
         }
     };
 
-    struct DelimNode{
-        std::unique_ptr<DelimNode> l;
-        std::unique_ptr<DelimNode> r;
+    //flat tree shared by the builder, the delim transform and the tree-walk decoder - children are indices into node
+    static inline constexpr uint32_t NIL_IDX = std::numeric_limits<uint32_t>::max();
+
+    struct TreeNode{
+        uint32_t l;
+        uint32_t r;
+        word_type c;
+        uint8_t delim_stat;
+        uint8_t reserved = 0;   //spells out the padding byte, so engine images built from the same model are byte-identical
+
+        template <class Reflector>
+        void dg_reflect(const Reflector& reflector) const{
+            reflector(l, r, c, delim_stat);
+        }
+
+        template <class Reflector>
+        void dg_reflect(const Reflector& reflector){
+            reflector(l, r, c, delim_stat);
+        }
+    };
+
+    struct Tree{
+        std::vector<TreeNode> node;
+        uint32_t root;
+
+        template <class Reflector>
+        void dg_reflect(const Reflector& reflector) const{
+            reflector(node, root);
+        }
+
+        template <class Reflector>
+        void dg_reflect(const Reflector& reflector){
+            reflector(node, root);
+        }
+    };
+
+    constexpr auto is_leaf(const TreeNode& node) -> bool{
+
+        return node.l == NIL_IDX;
+    }
+
+    //delim_stat of the rle escape leaf - delimiters use 1 + trailing byte count
+    static inline constexpr uint8_t ESCAPE_STAT = std::numeric_limits<uint8_t>::max();
+
+    //canonical model stored as per-symbol code lengths only
+    struct CodeLengthModel{
+        uint8_t encoding;
+        std::vector<uint8_t> payload;
+
+        template <class Reflector>
+        void dg_reflect(const Reflector& reflector) const{
+            reflector(encoding, payload);
+        }
+
+        template <class Reflector>
+        void dg_reflect(const Reflector& reflector){
+            reflector(encoding, payload);
+        }
+    };
+
+    struct DecodeEntry{
+        uint8_t bit_sz;                                             //0 if the leading code does not fit the peek or is a delimiter
+        uint8_t byte_sz;
+        std::array<char, constants::DECODE_ENTRY_BYTE_CAP> bytes;
+    };
+
+    static_assert(sizeof(DecodeEntry) == 8u);
+
+    //packed encoding dictionary entry - code length in the low ENCODE_ENTRY_LENGTH_BIT_SIZE bits, the code above it
+    //a quarter of a bit_array_type, so a 65536-entry table is 256KB instead of 1MB
+    struct EncodeEntry{
+        uint32_t packed;
+    };
+
+    static_assert(sizeof(EncodeEntry) == 4u);
+
+    static inline constexpr size_t ENCODE_ENTRY_LENGTH_BIT_SIZE = 6;
+
+    //requires bit_rep.second <= constants::PACKED_ENCODE_MAX_LENGTH
+    constexpr auto to_encode_entry(const bit_array_type& bit_rep) -> EncodeEntry{
+
+        return EncodeEntry{static_cast<uint32_t>((bit_rep.first << ENCODE_ENTRY_LENGTH_BIT_SIZE) | bit_rep.second)};
+    }
+
+    constexpr auto to_bit_array(EncodeEntry entry) -> bit_array_type{
+
+        constexpr auto LENGTH_BITMASK = (uint32_t{1} << ENCODE_ENTRY_LENGTH_BIT_SIZE) - 1u;
+        return {static_cast<bit_container_type>(entry.packed >> ENCODE_ENTRY_LENGTH_BIT_SIZE), static_cast<size_t>(entry.packed & LENGTH_BITMASK)};
+    }
+
+    struct DelimLeaf{
         word_type c;
         uint8_t delim_stat;
     };
+
+    struct CanonicalTable{
+        std::vector<uint64_t> limit;    //exclusive upper bound of each length, left-justified to MAX_CODE_LENGTH bits
+        std::vector<size_t> offset;     //leaf index minus first code of each length
+        std::vector<DelimLeaf> leaf;    //ordered by (length, code)
+        size_t min_length;
+        size_t max_length;              //0 if the tree is not canonical
+    };
+
+    struct TreeView{
+        std::span<const TreeNode> node;
+        uint32_t root;
+    };
+
+    struct CanonicalView{
+        std::span<const uint64_t> limit;
+        std::span<const size_t> offset;
+        std::span<const DelimLeaf> leaf;
+        size_t min_length;
+        size_t max_length;
+    };
 }
 
 namespace dg::huffman_encoder::utility{
@@ -84,24 +233,15 @@ namespace dg::huffman_encoder::utility{
         return rs;
     } 
 
-    template <class T,  std::enable_if_t<std::is_unsigned_v<T>, bool> = true>
-    static auto to_bit_deque(T val) -> std::deque<bool>{
-
-        auto rs         = std::deque<bool>();
-        auto idx_seq    = std::make_index_sequence<sizeof(T) * CHAR_BIT>{};
+    constexpr auto reverse_bits(uint32_t val) -> uint32_t{
 
-        [&]<size_t ...IDX>(const std::index_sequence<IDX...>&){
-            (
-                [&]{
-                    (void) IDX;
-                    rs.push_back(static_cast<bool>(val & 1));
-                    val >>= 1;
-                }(), ...
-            );
-        }(idx_seq);
+        val = ((val >> 1) & uint32_t{0x55555555u}) | ((val & uint32_t{0x55555555u}) << 1);
+        val = ((val >> 2) & uint32_t{0x33333333u}) | ((val & uint32_t{0x33333333u}) << 2);
+        val = ((val >> 4) & uint32_t{0x0F0F0F0Fu}) | ((val & uint32_t{0x0F0F0F0Fu}) << 4);
+        val = ((val >> 8) & uint32_t{0x00FF00FFu}) | ((val & uint32_t{0x00FF00FFu}) << 8);
 
-        return rs;
-    } 
+        return (val >> 16) | (val << 16);
+    }
 }
 
 namespace dg::huffman_encoder::byte_array{
@@ -201,7 +341,7 @@ namespace dg::huffman_encoder::bit_array{
 
     constexpr auto to_bit_array(char c) -> bit_array_type{
 
-        return {static_cast<bit_container_type>(c), CHAR_BIT};
+        return {static_cast<bit_container_type>(static_cast<unsigned char>(c)), CHAR_BIT};
     } 
 
     constexpr auto to_bit_array(bool c) -> bit_array_type{
@@ -254,7 +394,7 @@ namespace dg::huffman_encoder::bit_stream{
             }
         }
 
-        stream_buf.second = 0u;
+        stream_buf = bit_array_type{};
         return dst;
     }
 
@@ -274,448 +414,3300 @@ namespace dg::huffman_encoder::bit_stream{
         
         return static_cast<size_t>(sizeof(bit_container_type)) * CHAR_BIT;
     } 
-}
-
-namespace dg::huffman_encoder::make{
-
-    using namespace huffman_encoder::types;
-    
-    struct CounterNode{
-        std::unique_ptr<CounterNode> l;
-        std::unique_ptr<CounterNode> r;
-        size_t count;
-        word_type c;
-    };
-
-    static auto count(const char * buf, size_t sz) -> std::vector<size_t>{
 
-        auto counter    = std::vector<size_t>(constants::DICT_SIZE);
-        auto cycles     = sz / constants::ALPHABET_SIZE;
-        auto ibuf       = buf;
-        std::fill(counter.begin(), counter.end(), size_t{0u}); 
+    //writes the whole bytes of stream_buf, leaving fewer than CHAR_BIT bits - same stream, byte-granular state for put_ahead
+    static auto align_to(char * dst, bit_array_type& stream_buf) noexcept -> char *{
 
-        for (size_t i = 0; i < cycles; ++i){
-            auto num_rep = num_rep_type{};
-            dg::compact_serializer::core::deserialize(ibuf, num_rep);
-            counter[num_rep] += 1;
-            ibuf += constants::ALPHABET_SIZE;
-        } 
+        auto byte_sz = bit_array::size(stream_buf) / CHAR_BIT;
+        std::memcpy(dst, &stream_buf.first, byte_sz);
+        stream_buf.first    = (byte_sz == 0u) ? stream_buf.first : (stream_buf.first >> (byte_sz * CHAR_BIT));
+        stream_buf.second   -= byte_sz * CHAR_BIT;
 
-        return counter;
+        return dst + byte_sz;
     }
 
-    static auto clamp(std::vector<size_t> count){
-        
-        const auto MMIN     = size_t{1u};
-        auto transformer    = [=](size_t count){return std::max(MMIN, count);}; 
-        std::transform(count.begin(), count.end(), count.begin(), transformer);
+    //branch-free append on an aligned stream_buf: always stores a whole word at dst, which reaches up to 7 bytes past the
+    //last complete byte - those bytes are rewritten by later puts, the caller keeps them within the message
+    //requires size(stream_buf) + code_sz < array_cap()
+    static inline auto put_ahead(char * dst, bit_container_type code, size_t code_sz, bit_array_type& stream_buf) noexcept -> char *{
 
-        return count;
+        auto acc        = stream_buf.first | (code << stream_buf.second);
+        auto acc_sz     = stream_buf.second + code_sz;
+        auto byte_sz    = acc_sz / CHAR_BIT;
+        std::memcpy(dst, &acc, sizeof(bit_container_type));
+        stream_buf      = {acc >> (byte_sz * CHAR_BIT), acc_sz - byte_sz * CHAR_BIT};
+
+        return dst + byte_sz;
     }
+}
 
-    static auto build(std::vector<size_t> counter) -> std::unique_ptr<CounterNode>{
+namespace dg::huffman_encoder::encode_kernel{
 
-        if (counter.size() != constants::DICT_SIZE){
-            std::abort();
-        } 
+    using namespace huffman_encoder::types;
 
-        auto cmp        = [](const auto& lhs, const auto& rhs){return lhs->count > rhs->count;};
-        auto heap       = std::vector<std::unique_ptr<CounterNode>>{};
+    //the encode loop of FastEngine without per-symbol flush branches - codes are read from the encoding dictionary,
+    //merged two at a time when they fit one word, and appended with bit_stream::put_ahead
+    //the output stream is bit-identical to stream_to; rdbuf comes back aligned (fewer than CHAR_BIT bits)
+    //dict is either the wide bit_array_type table or the packed model::EncodeEntry one
 
-        for (size_t i = 0; i < constants::DICT_SIZE; ++i){
-            auto num_rep    = static_cast<num_rep_type>(i);
-            auto word       = word_type{};
-            dg::compact_serializer::core::serialize(num_rep, word.data());
-            auto cnode      = std::make_unique<CounterNode>(CounterNode{nullptr, nullptr, counter[i], word});
-            heap.push_back(std::move(cnode));
-        }
+    constexpr auto code(const bit_array_type& entry) -> bit_container_type{
 
-        std::make_heap(heap.begin(), heap.end(), cmp);
+        return entry.first;
+    }
 
-        while (heap.size() != 1){
-            std::pop_heap(heap.begin(), heap.end(), cmp);
-            std::pop_heap(heap.begin(), std::prev(heap.end()), cmp);
-            auto first  = std::move(heap.back()); 
-            heap.pop_back();
-            auto second = std::move(heap.back());
-            heap.pop_back();
-            auto count  = first->count + second->count; 
-            auto cnode  = std::make_unique<CounterNode>(CounterNode{std::move(first), std::move(second), count, {}});
-            heap.push_back(std::move(cnode));
-            std::push_heap(heap.begin(), heap.end(), cmp);
-        }  
+    constexpr auto code(model::EncodeEntry entry) -> bit_container_type{
 
-        return std::move(heap.back());
+        return entry.packed >> model::ENCODE_ENTRY_LENGTH_BIT_SIZE;
     }
 
-    static auto to_model(CounterNode * root) -> std::unique_ptr<model::Node>{
+    constexpr auto length(const bit_array_type& entry) -> size_t{
 
-        if (!root){
-            return {};
-        }
+        return entry.second;
+    }
 
-        auto rs     = std::make_unique<model::Node>();
-        rs->c       = root->c;
-        rs->l       = to_model(root->l.get());
-        rs->r       = to_model(root->r.get());
+    constexpr auto length(model::EncodeEntry entry) -> size_t{
 
-        return rs;
-    } 
-    
-    static auto to_delim_model(model::Node * root) -> std::unique_ptr<model::DelimNode>{
+        return entry.packed & ((uint32_t{1} << model::ENCODE_ENTRY_LENGTH_BIT_SIZE) - 1u);
+    }
 
-        if (!root){
-            return {};
+    template <size_t ALPHABET_SIZE, class Entry>
+    __attribute__((always_inline)) inline auto encode_loop(const Entry * dict, const char * inp_buf, size_t cycles, char * op_buf, bit_array_type& rdbuf, bool is_pairable) noexcept -> std::pair<const char *, char *>{
+
+        op_buf          = bit_stream::align_to(op_buf, rdbuf);
+        auto stream_buf = rdbuf; //a local the word stores cannot alias, so it stays in registers
+        size_t i        = 0u;
+
+        if (is_pairable){
+            for (; i + 2 <= cycles; i += 2){
+                auto lhs    = num_rep_type<ALPHABET_SIZE>{};
+                auto rhs    = num_rep_type<ALPHABET_SIZE>{};
+                inp_buf     = dg::compact_serializer::core::deserialize(inp_buf, lhs);
+                inp_buf     = dg::compact_serializer::core::deserialize(inp_buf, rhs);
+                auto pair   = code(dict[lhs]) | (code(dict[rhs]) << length(dict[lhs]));
+                op_buf      = bit_stream::put_ahead(op_buf, pair, length(dict[lhs]) + length(dict[rhs]), stream_buf);
+            }
         }
 
-        auto rs         = std::make_unique<model::DelimNode>();
-        rs->c           = root->c;
-        rs->l           = to_delim_model(root->l.get());
-        rs->r           = to_delim_model(root->r.get());
-        rs->delim_stat  = 0u;
+        for (; i < cycles; ++i){
+            auto num_rep    = num_rep_type<ALPHABET_SIZE>{};
+            inp_buf         = dg::compact_serializer::core::deserialize(inp_buf, num_rep);
+            op_buf          = bit_stream::put_ahead(op_buf, code(dict[num_rep]), length(dict[num_rep]), stream_buf);
+        }
 
-        return rs;
+        rdbuf = stream_buf;
+        return {inp_buf, op_buf};
     }
 
-    static void encode_dictionarize(model::DelimNode * root, std::vector<std::vector<bool>>& op, std::vector<bool>& trace){
+    template <size_t ALPHABET_SIZE, class Entry>
+    auto scalar(const Entry * dict, const char * inp_buf, size_t cycles, char * op_buf, bit_array_type& rdbuf, bool is_pairable) noexcept -> std::pair<const char *, char *>{
+
+        return encode_loop<ALPHABET_SIZE>(dict, inp_buf, cycles, op_buf, rdbuf, is_pairable);
+    }
 
-        bool is_leaf = !bool{root->r} && !bool{root->l};
+#ifdef DG_HUFFMAN_ENCODER_X86_KERNEL
 
-        if (is_leaf){
-            if (!root->delim_stat){
-                auto num_rep    = num_rep_type{};
-                dg::compact_serializer::core::deserialize(root->c.data(), num_rep);
-                op[num_rep]     = trace;
-            }
-        } else{
-            trace.push_back(constants::L);
-            encode_dictionarize(root->l.get(), op, trace);
-            trace.push_back(constants::R);
-            encode_dictionarize(root->r.get(), op, trace);
-        }
+    //same loop with shlx/shrx - the variable shifts carry the loop dependency, the legacy shift-by-cl costs extra uops
+    template <size_t ALPHABET_SIZE, class Entry>
+    __attribute__((target("bmi2"))) auto bmi2(const Entry * dict, const char * inp_buf, size_t cycles, char * op_buf, bit_array_type& rdbuf, bool is_pairable) noexcept -> std::pair<const char *, char *>{
 
-        trace.pop_back();
+        return encode_loop<ALPHABET_SIZE>(dict, inp_buf, cycles, op_buf, rdbuf, is_pairable);
     }
 
-    static auto encode_dictionarize(model::DelimNode * root) -> std::vector<std::vector<bool>>{
+#endif
 
-        auto rs     = std::vector<std::vector<bool>>(constants::DICT_SIZE);
-        auto trace  = std::vector<bool>();
-        encode_dictionarize(root, rs, trace);
+    inline auto has_bmi2() noexcept -> bool{
 
+#ifdef DG_HUFFMAN_ENCODER_X86_KERNEL
+        static const bool rs = __builtin_cpu_supports("bmi2");
         return rs;
+#else
+        return false;
+#endif
     }
-    
-    static auto walk(model::DelimNode * root, std::deque<bool> trace) -> std::pair<std::vector<char>, size_t>{
 
-        auto cursor     = root;
-        auto init_sz    = trace.size();
+    //is_pairable: no code in dict is longer than constants::ENCODE_PAIR_MAX_LENGTH
+    template <size_t ALPHABET_SIZE, class Entry>
+    auto encode(const Entry * dict, const char * inp_buf, size_t cycles, char * op_buf, bit_array_type& rdbuf, bool is_pairable) noexcept -> std::pair<const char *, char *>{
 
-        while (!trace.empty()){
+#ifdef DG_HUFFMAN_ENCODER_X86_KERNEL
+        if (has_bmi2()){
+            return bmi2<ALPHABET_SIZE>(dict, inp_buf, cycles, op_buf, rdbuf, is_pairable);
+        }
+#endif
+        return scalar<ALPHABET_SIZE>(dict, inp_buf, cycles, op_buf, rdbuf, is_pairable);
+    }
+}
 
-            bool cur = trace.front();
-            trace.pop_front();
+namespace dg::huffman_encoder::interleaved{
 
-            if (cur == constants::L){
-                cursor = cursor->l.get();
-            } else{
-                cursor = cursor->r.get();
-            }
+    using namespace huffman_encoder::types;
 
-            bool is_leaf = !bool{cursor->l} && !bool{cursor->r};
+    //header: uint8_t lane_sz | uint64_t inp_sz | uint64_t lane byte size x lane_sz, followed by the byte-aligned lanes
 
-            if (is_leaf){
-                if (cursor->delim_stat){
-                    break;
-                }
-                
-                auto [byte_rep, trailing]  = walk(root, trace);
+    constexpr auto header_size(size_t lane_sz) -> size_t{
 
-                if (trailing == trace.size()){
-                    return {{cursor->c.begin(), cursor->c.end()}, trace.size()};
-                }
+        return sizeof(uint8_t) + sizeof(uint64_t) + sizeof(uint64_t) * lane_sz;
+    }
 
-                auto aggregated = std::vector<char>(cursor->c.begin(), cursor->c.end());
-                aggregated.insert(aggregated.end(), byte_rep.begin(), byte_rep.end());
+    template <size_t ALPHABET_SIZE>
+    constexpr auto segment_size(size_t inp_sz, size_t lane_sz) -> size_t{
 
-                return {aggregated, trailing};
-            }
-        }
+        return inp_sz / lane_sz / ALPHABET_SIZE * ALPHABET_SIZE;
+    }
 
-        return {{}, init_sz};    
-    } 
+    constexpr auto max_encoding_size(size_t inp_sz, size_t lane_sz) -> size_t{
+
+        return header_size(lane_sz) + constants::MAX_ENCODING_SZ_PER_BYTE * inp_sz + sizeof(bit_container_type) * lane_sz;
+    }
+}
 
-    static auto decode_dictionarize(model::DelimNode * root) -> std::vector<std::pair<std::vector<char>, size_t>>{
+namespace dg::huffman_encoder::frame{
 
-        auto rs     = std::vector<std::pair<std::vector<char>, size_t>>(constants::DICT_SIZE);
+    //header: uint64_t inp_sz | uint64_t block_sz | uint64_t block byte size x block_count, followed by the byte-aligned blocks
+    //a block whose byte size equals its decoded size is stored raw - the encoder never keeps a Huffman block that does not shrink
+    //adaptive frames mark stored blocks with STORED_WIDTH instead, their byte size carries the width prefix
 
-        for (size_t i = 0; i < constants::DICT_SIZE; ++i){
-            rs[i]   = walk(root, utility::to_bit_deque(static_cast<num_rep_type>(i))); 
-        }
+    static inline constexpr uint8_t STORED_WIDTH = 0;
 
-        return rs;
+    constexpr auto block_count(size_t inp_sz, size_t block_sz) -> size_t{
+
+        return (inp_sz + block_sz - 1) / block_sz;
     }
 
-    static auto find_min_path_to_leaf(model::DelimNode * root, size_t depth = 0) -> std::pair<model::DelimNode *, size_t>{
-        
-        bool is_leaf    = !bool{root->r} && !bool{root->r};
+    constexpr auto header_size(size_t block_count) -> size_t{
 
-        if (is_leaf){
-            return {root, depth};
-        }
+        return sizeof(uint64_t) + sizeof(uint64_t) + sizeof(uint64_t) * block_count;
+    }
 
-        auto [l_leaf, l_depth]  = find_min_path_to_leaf(root->l.get(), depth + 1);
-        auto [r_leaf, r_depth]  = find_min_path_to_leaf(root->r.get(), depth + 1);
+    constexpr auto max_encoding_size(size_t inp_sz, size_t block_sz) -> size_t{
 
-        if (l_depth < r_depth){
-            return {l_leaf, l_depth};
-        }
+        return header_size(block_count(inp_sz, block_sz)) + inp_sz;
+    }
 
-        return {r_leaf, r_depth};
+    //adaptive frames prefix every block with a uint8_t symbol width, counted in the block byte size
+    constexpr auto max_adaptive_encoding_size(size_t inp_sz, size_t block_sz) -> size_t{
+
+        return max_encoding_size(inp_sz, block_sz) + sizeof(uint8_t) * block_count(inp_sz, block_sz);
     }
+}
 
-    static auto to_delim_tree(model::Node * huffman_tree) -> std::unique_ptr<model::DelimNode>{
+namespace dg::huffman_encoder::image{
 
-        auto delim_model    = to_delim_model(huffman_tree);
+    using namespace huffman_encoder::types;
 
-        for (size_t i = 0; i < constants::ALPHABET_SIZE; ++i){
-            auto [leaf, v]      = find_min_path_to_leaf(delim_model.get());
-            leaf->l             = std::make_unique<model::DelimNode>(model::DelimNode{{}, {}, leaf->c, leaf->delim_stat});
-            leaf->r             = std::make_unique<model::DelimNode>(model::DelimNode{{}, {}, {}, static_cast<uint8_t>(i + 1)}); 
-        }
+    //flat, position-independent engine: Header followed by SECTION_ALIGNMENT-aligned tables that the engine views in place
 
-        return delim_model;
-    } 
+    static inline constexpr uint64_t MAGIC              = 0x474D494655484744ull; //"DGHUFIMG"
+    static inline constexpr uint64_t VERSION            = 5u;
+    static inline constexpr size_t SECTION_ALIGNMENT    = 64u;
+    static inline constexpr uint64_t ENCODE_ROLE        = 1u;
+    static inline constexpr uint64_t DECODE_ROLE        = 2u;
+    static inline constexpr uint64_t FULL_ROLE          = ENCODE_ROLE | DECODE_ROLE;
+
+    struct Section{
+        uint64_t offs;
+        uint64_t sz;
+        uint64_t elem_sz;
+    };
 
-    static void find_delim(model::DelimNode * root, std::vector<std::vector<bool>>& rs, std::vector<bool>& trace){
+    struct Header{
+        uint64_t magic;
+        uint64_t version;
+        uint64_t image_sz;
+        uint64_t checksum;          //utility::hash of everything past the header
+        uint64_t alphabet_sz;
+        uint64_t role;              //ENCODE_ROLE and/or DECODE_ROLE - the sections of a missing role are empty
+        uint64_t tree_root;
+        uint64_t canonical_min_length;
+        uint64_t canonical_max_length;
+        uint64_t encoding_max_length;   //longest symbol code - picks the encode kernel
+        Section encoding_dict;          //DICT_SIZE entries, or none when packed_encoding_dict holds the codes
+        Section packed_encoding_dict;   //DICT_SIZE entries if encoding_max_length <= PACKED_ENCODE_MAX_LENGTH, none otherwise
+        Section delim;
+        Section escape;             //0 or 1 entries - the rle escape code
+        Section tree_node;
+        Section decoding_dict;
+        Section canonical_limit;
+        Section canonical_offset;
+        Section canonical_leaf;
+    };
 
-        bool is_leaf    = !bool{root->l} && !bool{root->r};
+    static_assert(std::is_trivially_copyable_v<Header>);
+    static_assert(std::is_trivially_copy_constructible_v<bit_array_type> && std::is_standard_layout_v<bit_array_type>);
+    static_assert(std::is_trivially_copyable_v<model::TreeNode> && std::has_unique_object_representations_v<model::TreeNode>);
+    static_assert(std::is_trivially_copyable_v<model::DecodeEntry>);
+    static_assert(std::is_trivially_copyable_v<model::EncodeEntry>);
+    static_assert(std::is_trivially_copyable_v<model::DelimLeaf>);
 
-        if (is_leaf){
-            if (root->delim_stat){
-                rs[root->delim_stat - 1]   = trace; 
-            }
-        } else{
-            trace.push_back(constants::L);
-            find_delim(root->l.get(), rs, trace);
-            trace.push_back(constants::R);
-            find_delim(root->r.get(), rs, trace);
-        }
+    constexpr auto align(size_t offs) -> size_t{
 
-        trace.pop_back();
+        return (offs + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
     }
 
-    static auto find_delim(model::DelimNode * root) -> std::vector<std::vector<bool>>{
+    template <class T>
+    constexpr auto make_section(size_t& offs, size_t sz) -> Section{
 
-        auto trace  = std::vector<bool>{};
-        auto rs     = std::vector<std::vector<bool>>(constants::ALPHABET_SIZE);
-        find_delim(root, rs, trace);
+        auto rs = Section{align(offs), sz, sizeof(T)};
+        offs    = rs.offs + sizeof(T) * sz;
 
         return rs;
     }
-}
 
-namespace dg::huffman_encoder::core{
-    
-    using namespace types;
+    template <class T>
+    void write_section(char * image, const Section& section, std::span<const T> data){
 
-    class FastEngine{
+        if (!data.empty()){
+            std::memcpy(image + section.offs, data.data(), sizeof(T) * data.size());
+        }
+    }
 
-        private:
+    template <class T>
+    auto view_section(const char * image, const Section& section) -> std::span<const T>{
 
-            std::vector<bit_array_type> encoding_dict;
-            std::vector<bit_array_type> delim;
-            std::unique_ptr<model::DelimNode> delim_tree;
-            std::vector<std::pair<std::vector<char>, size_t>> decoding_dict;
+        return {reinterpret_cast<const T *>(image + section.offs), static_cast<size_t>(section.sz)};
+    }
 
-        public:
+    auto read_header(const char * image) -> Header{
 
-            FastEngine(std::vector<bit_array_type> encoding_dict, 
-                       std::vector<bit_array_type> delim, 
-                       std::unique_ptr<model::DelimNode> delim_tree,
-                       std::vector<std::pair<std::vector<char>, size_t>> decoding_dict): encoding_dict(std::move(encoding_dict)),
-                                                                                         delim(std::move(delim)),
-                                                                                         delim_tree(std::move(delim_tree)),
-                                                                                         decoding_dict(std::move(decoding_dict)){}
-             
-            auto noexhaust_encode_into(const char * inp_buf, size_t inp_sz, char * op_buf, bit_array_type& rdbuf) const noexcept -> char *{
-                
-                size_t cycles   = inp_sz / constants::ALPHABET_SIZE; 
-                size_t rem      = inp_sz - (cycles * constants::ALPHABET_SIZE);
-                auto ibuf       = inp_buf;
+        auto rs = Header{};
+        std::memcpy(&rs, image, sizeof(Header));
 
-                for (size_t i = 0; i < cycles; ++i){
-                    auto num_rep    = num_rep_type{};
-                    ibuf            = dg::compact_serializer::core::deserialize(ibuf, num_rep);
-                    auto& bit_rep   = encoding_dict[num_rep];
-                    op_buf          = bit_stream::stream_to(op_buf, bit_rep, rdbuf);
-                }
+        return rs;
+    }
 
-                op_buf  = bit_stream::stream_to(op_buf, this->delim[rem], rdbuf);
+    auto checksum(const char * image, size_t image_sz) -> uint64_t{
 
-                for (size_t i = 0; i < rem; ++i){
-                    op_buf  = bit_stream::stream_to(op_buf, bit_array::to_bit_array(ibuf[i]), rdbuf);
-                }
-                                
-                return op_buf;
-            }
-            
-            auto encode_into(const char * inp_buf, size_t inp_sz, char * op_buf, bit_array_type& rdbuf) const noexcept -> char *{
+        return dg::compact_serializer::utility::hash(image + sizeof(Header), image_sz - sizeof(Header));
+    }
 
-                return bit_stream::exhaust_to(noexhaust_encode_into(inp_buf, inp_sz, op_buf, rdbuf), rdbuf);
-            }
-            
-            //REVIEW:
-            auto fast_decode_into(const char * inp_buf, size_t bit_offs, size_t bit_last, char * op_buf) const noexcept -> std::pair<size_t, char *>{
-                
-                auto cursor     = this->delim_tree.get();
-                auto root       = this->delim_tree.get();
-                auto bad_bit    = bool{false};
-                 
-                while (true){
+    template <class T>
+    void verify_section(const Section& section, size_t image_sz){
 
-                    bool dictionary_prereq = (bit_offs + bit_stream::read_padd_requirement() < bit_last) && (cursor == root) && (!bad_bit);
+        using dg::compact_serializer::runtime_exception::CorruptedError;
 
-                    if (dictionary_prereq){
-                        auto tape = bit_stream::read(inp_buf, bit_offs, std::integral_constant<size_t, constants::ALPHABET_BIT_SIZE>{});
-                        const auto& mapped_bytes = this->decoding_dict[tape];
-                        std::memcpy(op_buf, mapped_bytes.first.data(), mapped_bytes.first.size());
-                        op_buf   += mapped_bytes.first.size();
-                        bit_offs += constants::ALPHABET_BIT_SIZE - mapped_bytes.second;
-                        bad_bit  = mapped_bytes.second == constants::ALPHABET_BIT_SIZE;
-                    } else{
-                        bad_bit     = false;
-                        auto tape   = byte_array::read(inp_buf, bit_offs++); 
-                        
-                        if (tape == constants::L){
-                            cursor = cursor->l.get();
-                        } else{
-                            cursor = cursor->r.get();
-                        }
+        if (section.elem_sz != sizeof(T) || section.offs % SECTION_ALIGNMENT != 0u || section.offs > image_sz || section.sz > (image_sz - section.offs) / sizeof(T)){
+            throw CorruptedError{};
+        }
+    }
 
-                        bool is_leaf = !bool{cursor->r} && !bool{cursor->l};
+    //the image must start at a SECTION_ALIGNMENT-aligned address (memory::ImageAllocator and mmap both qualify)
+    //and carry exactly the tables of role
+    template <size_t ALPHABET_SIZE>
+    auto verify(const char * image, size_t image_sz, bool verify_checksum = true, uint64_t role = FULL_ROLE) -> Header{
 
-                        if (is_leaf){
-                            if (cursor->delim_stat){
-                                auto trailing_sz    = cursor->delim_stat -1;
-                                for (size_t i = 0; i < trailing_sz; ++i){
-                                    (*op_buf++) = byte_array::read_byte(inp_buf, bit_offs);
-                                    bit_offs += CHAR_BIT;
-                                }
-                                return {bit_offs, op_buf};
-                            }
-                            std::memcpy(op_buf, cursor->c.data(), constants::ALPHABET_SIZE);
-                            op_buf += constants::ALPHABET_SIZE;
-                            cursor = root;
-                        }
-                    }
-                } 
-            }
+        using dg::compact_serializer::runtime_exception::CorruptedError;
 
-            auto decode_into(const char * inp_buf, size_t bit_offs, char * op_buf) const noexcept -> std::pair<size_t, char *>{
+        if (image_sz < sizeof(Header) || reinterpret_cast<uintptr_t>(image) % SECTION_ALIGNMENT != 0u){
+            throw CorruptedError{};
+        }
 
-                auto cursor     = this->delim_tree.get();
-                auto root       = this->delim_tree.get();
-                 
-                while (true){
-                    auto tape   = byte_array::read(inp_buf, bit_offs++); 
-                    
-                    if (tape == constants::L){
-                        cursor = cursor->l.get();
-                    } else{
-                        cursor = cursor->r.get();
-                    }
+        auto header = read_header(image);
 
-                    bool is_leaf = !bool{cursor->r} && !bool{cursor->l};
+        if (header.magic != MAGIC || header.version != VERSION || header.image_sz != image_sz || header.alphabet_sz != ALPHABET_SIZE || header.role != role){
+            throw CorruptedError{};
+        }
 
-                    if (is_leaf){
-                        if (cursor->delim_stat){
-                            auto trailing_sz    = cursor->delim_stat -1;
-                            for (size_t i = 0; i < trailing_sz; ++i){
-                                (*op_buf++) = byte_array::read_byte(inp_buf, bit_offs);
-                                bit_offs += CHAR_BIT;
-                            }
-                            return {bit_offs, op_buf};
-                        }
-                        std::memcpy(op_buf, cursor->c.data(), constants::ALPHABET_SIZE);
-                        op_buf += constants::ALPHABET_SIZE;
-                        cursor = root;
-                    }
-                } 
-            }
-    };
+        if (verify_checksum && header.checksum != checksum(image, image_sz)){
+            throw CorruptedError{};
+        }
 
-    class RowEncodingEngine{
+        verify_section<bit_array_type>(header.encoding_dict, image_sz);
+        verify_section<model::EncodeEntry>(header.packed_encoding_dict, image_sz);
+        verify_section<bit_array_type>(header.delim, image_sz);
+        verify_section<bit_array_type>(header.escape, image_sz);
+        verify_section<model::TreeNode>(header.tree_node, image_sz);
+        verify_section<model::DecodeEntry>(header.decoding_dict, image_sz);
+        verify_section<uint64_t>(header.canonical_limit, image_sz);
+        verify_section<size_t>(header.canonical_offset, image_sz);
+        verify_section<model::DelimLeaf>(header.canonical_leaf, image_sz);
+
+        auto has_encode = (role & ENCODE_ROLE) != 0u;
+        auto has_decode = (role & DECODE_ROLE) != 0u;
+        auto dict_sz    = has_encode ? constants::DICT_SIZE<ALPHABET_SIZE> : size_t{0u};
+        auto is_packed  = header.encoding_max_length <= constants::PACKED_ENCODE_MAX_LENGTH;
+
+        if (header.encoding_dict.sz != (is_packed ? 0u : dict_sz) || header.packed_encoding_dict.sz != (is_packed ? dict_sz : 0u)){
+            throw CorruptedError{};
+        }
 
-        private:
+        if (header.delim.sz != (has_encode ? ALPHABET_SIZE : 0u) || header.escape.sz > 1u || header.decoding_dict.sz != (has_decode ? constants::DECODE_TABLE_SIZE : 0u) || (has_decode && header.tree_root >= header.tree_node.sz)){
+            throw CorruptedError{};
+        }
 
-            std::vector<std::unique_ptr<FastEngine>> encoders;
-        
-        public:
+        if (header.canonical_max_length > constants::MAX_CODE_LENGTH || header.encoding_max_length > constants::MAX_CODE_LENGTH || header.canonical_limit.sz != header.canonical_offset.sz || (header.canonical_max_length != 0u && header.canonical_limit.sz != header.canonical_max_length + 1)){
+            throw CorruptedError{};
+        }
 
-            RowEncodingEngine(std::vector<std::unique_ptr<FastEngine>> encoders): encoders(std::move(encoders)){}
+        return header;
+    }
+}
 
-            auto encode_into(const std::vector<std::pair<const char *, size_t>>& data, char * buf) const -> char *{
+namespace dg::huffman_encoder::memory{
 
-                assert(data.size() == this->encoders.size()); 
-                auto rdbuf = types::bit_array_type{};
+    //backing storage for engine images - spawn_fast_engine asks one for every image it builds
+    //allocate returns sz bytes at an image::SECTION_ALIGNMENT-aligned address; the owner releases them
+    class ImageAllocator{
 
-                for (size_t i = 0; i < data.size(); ++i){
-                    buf = this->encoders[i]->noexhaust_encode_into(data[i].first, data[i].second, buf, rdbuf);
-                }
+        public:
 
-                return bit_stream::exhaust_to(buf, rdbuf);
-            }
+            virtual ~ImageAllocator() noexcept = default;
+            virtual auto allocate(size_t sz) -> std::shared_ptr<char> = 0;
+    };
 
-            auto decode_into(const char * buf, std::vector<std::pair<char *, size_t>>& data) const -> const char *{
+    class AlignedAllocator: public ImageAllocator{
 
-                assert(data.size() == this->encoders.size());
-                auto buf_bit_offs   = size_t{0u};
-                auto last           = std::add_pointer_t<char>();
+        public:
 
-                for (size_t i = 0; i < this->encoders.size(); ++i){
-                    std::tie(buf_bit_offs, last) = this->encoders[i]->decode_into(buf, buf_bit_offs, data[i].first);
-                    data[i].second = std::distance(data[i].first, last); 
-                }
+            auto allocate(size_t sz) -> std::shared_ptr<char> override{
 
-                return buf + byte_array::byte_size(buf_bit_offs);
+                static constexpr auto ALIGNMENT = std::align_val_t{image::SECTION_ALIGNMENT};
+                return std::shared_ptr<char>(static_cast<char *>(::operator new(sz, ALIGNMENT)), [](char * buf) noexcept{::operator delete(buf, ALIGNMENT);});
             }
     };
-}
+
+    inline auto default_allocator() noexcept -> ImageAllocator&{
+
+        static auto rs = AlignedAllocator{};
+        return rs;
+    }
+}
+
+namespace dg::huffman_encoder::stats{
+
+    //decode counters - the decoders take any sink with this interface, NoStats is the default and compiles to nothing
+    //a DecodeStats is plain data: keep one per thread or per engine and merge with += before exporting
+
+    struct NoStats{
+        constexpr void table(size_t, size_t) noexcept{}
+        constexpr void canonical(bool) noexcept{}
+        constexpr void fallback_bit() noexcept{}
+        constexpr void fallback_symbol() noexcept{}
+        constexpr void delim(size_t) noexcept{}
+        constexpr void message(size_t, size_t) noexcept{}
+        constexpr void stored(size_t) noexcept{}
+        constexpr void run(size_t) noexcept{}
+        constexpr auto operator +=(const NoStats&) noexcept -> NoStats&{return *this;}
+    };
+
+    struct DecodeStats{
+        uint64_t message_count;
+        uint64_t inp_bit_sz;            //delimiter and trailing bytes included
+        uint64_t op_byte_sz;
+        uint64_t symbol_count;          //delimiters excluded
+        uint64_t table_hit;             //dictionary peeks that produced output
+        uint64_t table_miss;            //dictionary peeks that deferred to the canonical or per-bit path
+        uint64_t canonical_hit;
+        uint64_t fallback_bit_sz;       //bits walked one at a time through the delim tree
+        uint64_t fallback_symbol_count;
+        uint64_t delim_count;
+        uint64_t trailing_byte_sz;
+        uint64_t stored_block_count;    //frame blocks copied raw, counted in inp_bit_sz and op_byte_sz but not in message_count
+        uint64_t stored_byte_sz;
+        uint64_t run_count;             //rle escapes, counted in canonical_hit or fallback_bit_sz like any other code
+        uint64_t run_symbol_count;      //symbols expanded from rle escapes, included in symbol_count
+
+        constexpr void table(size_t bit_sz, size_t symbol_sz) noexcept{
+
+            this->table_hit     += bit_sz != 0u;
+            this->table_miss    += bit_sz == 0u;
+            this->symbol_count  += symbol_sz;
+        }
+
+        constexpr void canonical(bool is_delim) noexcept{    //escapes count as delimiters here
+
+            this->canonical_hit += 1u;
+            this->symbol_count  += !is_delim;
+        }
+
+        constexpr void fallback_bit() noexcept{
+
+            this->fallback_bit_sz += 1u;
+        }
+
+        constexpr void fallback_symbol() noexcept{
+
+            this->fallback_symbol_count += 1u;
+            this->symbol_count          += 1u;
+        }
+
+        constexpr void delim(size_t trailing_sz) noexcept{
+
+            this->delim_count       += 1u;
+            this->trailing_byte_sz  += trailing_sz;
+        }
+
+        constexpr void message(size_t bit_sz, size_t byte_sz) noexcept{
+
+            this->message_count += 1u;
+            this->inp_bit_sz    += bit_sz;
+            this->op_byte_sz    += byte_sz;
+        }
+
+        constexpr void stored(size_t byte_sz) noexcept{
+
+            this->stored_block_count    += 1u;
+            this->stored_byte_sz        += byte_sz;
+            this->inp_bit_sz            += byte_sz * CHAR_BIT;
+            this->op_byte_sz            += byte_sz;
+        }
+
+        constexpr void run(size_t symbol_sz) noexcept{
+
+            this->run_count         += 1u;
+            this->run_symbol_count  += symbol_sz;
+            this->symbol_count      += symbol_sz;
+        }
+
+        constexpr auto operator +=(const DecodeStats& other) noexcept -> DecodeStats&{
+
+            this->message_count         += other.message_count;
+            this->inp_bit_sz            += other.inp_bit_sz;
+            this->op_byte_sz            += other.op_byte_sz;
+            this->symbol_count          += other.symbol_count;
+            this->table_hit             += other.table_hit;
+            this->table_miss            += other.table_miss;
+            this->canonical_hit         += other.canonical_hit;
+            this->fallback_bit_sz       += other.fallback_bit_sz;
+            this->fallback_symbol_count += other.fallback_symbol_count;
+            this->delim_count           += other.delim_count;
+            this->trailing_byte_sz      += other.trailing_byte_sz;
+            this->stored_block_count    += other.stored_block_count;
+            this->stored_byte_sz        += other.stored_byte_sz;
+            this->run_count             += other.run_count;
+            this->run_symbol_count      += other.run_symbol_count;
+
+            return *this;
+        }
+
+        //effective compressed bits per decoded byte
+        constexpr auto bits_per_byte() const noexcept -> double{
+
+            return (this->op_byte_sz == 0u) ? 0.0 : static_cast<double>(this->inp_bit_sz) / this->op_byte_sz;
+        }
+
+        //mean code length over symbols and delimiters, trailing and stored raw bytes excluded
+        constexpr auto average_code_length() const noexcept -> double{
+
+            auto code_sz = this->symbol_count + this->delim_count;
+            return (code_sz == 0u) ? 0.0 : static_cast<double>(this->inp_bit_sz - (this->trailing_byte_sz + this->stored_byte_sz) * CHAR_BIT) / code_sz;
+        }
+    };
+}
+
+namespace dg::huffman_encoder::make{
+
+    using namespace huffman_encoder::types;
+    
+    //one narrow sub-histogram per symbol slot of a machine word, so repeated symbols do not serialize on a single counter
+    struct HistogramCounter{
+        std::vector<uint32_t> sub;
+        std::vector<size_t> total;
+        size_t pending_cycles;
+    };
+
+    template <size_t ALPHABET_SIZE>
+    static inline constexpr size_t COUNT_SYMBOL_PER_WORD = sizeof(bit_container_type) / ALPHABET_SIZE;
+
+    template <size_t ALPHABET_SIZE>
+    static auto make_histogram_counter() -> HistogramCounter{
+
+        return {std::vector<uint32_t>(COUNT_SYMBOL_PER_WORD<ALPHABET_SIZE> * constants::DICT_SIZE<ALPHABET_SIZE>, uint32_t{0u}), std::vector<size_t>(constants::DICT_SIZE<ALPHABET_SIZE>, size_t{0u}), size_t{0u}};
+    }
+
+    template <size_t ALPHABET_SIZE>
+    static void flush(HistogramCounter& counter){
+
+        for (size_t i = 0; i < COUNT_SYMBOL_PER_WORD<ALPHABET_SIZE>; ++i){
+            auto sub = std::next(counter.sub.begin(), i * constants::DICT_SIZE<ALPHABET_SIZE>);
+            std::transform(counter.total.begin(), counter.total.end(), sub, counter.total.begin(), std::plus<size_t>{});
+            std::fill(sub, std::next(sub, constants::DICT_SIZE<ALPHABET_SIZE>), uint32_t{0u});
+        }
+
+        counter.pending_cycles = 0u;
+    }
+
+    template <size_t ALPHABET_SIZE>
+    static void count_into(const char * buf, size_t sz, HistogramCounter& counter){
+
+        constexpr auto SYMBOL_BITMASK   = (bit_container_type{1} << constants::ALPHABET_BIT_SIZE<ALPHABET_SIZE>) - 1;
+        auto cycles                     = sz / sizeof(bit_container_type);
+        auto rem_cycles                 = (sz - cycles * sizeof(bit_container_type)) / ALPHABET_SIZE;
+        auto ibuf                       = buf;
+        auto sub                        = counter.sub.data();
+
+        while (cycles != 0u){
+            auto step = std::min(cycles, constants::COUNT_FLUSH_CYCLE_SZ - counter.pending_cycles);
+
+            for (size_t i = 0; i < step; ++i){
+                auto word   = bit_container_type{};
+                ibuf        = dg::compact_serializer::core::deserialize(ibuf, word);
+
+                [&]<size_t ...IDX>(const std::index_sequence<IDX...>){
+                    ((sub[IDX * constants::DICT_SIZE<ALPHABET_SIZE> + ((word >> (IDX * constants::ALPHABET_BIT_SIZE<ALPHABET_SIZE>)) & SYMBOL_BITMASK)] += 1), ...);
+                }(std::make_index_sequence<COUNT_SYMBOL_PER_WORD<ALPHABET_SIZE>>{});
+            }
+
+            counter.pending_cycles  += step;
+            cycles                  -= step;
+
+            if (counter.pending_cycles == constants::COUNT_FLUSH_CYCLE_SZ){
+                flush<ALPHABET_SIZE>(counter);
+            }
+        }
+
+        for (size_t i = 0; i < rem_cycles; ++i){
+            auto num_rep = num_rep_type<ALPHABET_SIZE>{};
+            ibuf = dg::compact_serializer::core::deserialize(ibuf, num_rep);
+            counter.total[num_rep] += 1;
+        }
+    }
+
+    template <size_t ALPHABET_SIZE>
+    static auto count(const char * buf, size_t sz) -> std::vector<size_t>{
+
+        auto counter = make_histogram_counter<ALPHABET_SIZE>();
+        count_into<ALPHABET_SIZE>(buf, sz, counter);
+        flush<ALPHABET_SIZE>(counter);
+
+        return std::move(counter.total);
+    }
+
+    //counts every sample_stride-th block of COUNT_BLOCK_SZ bytes, spread across the pool and merged at the end
+    template <size_t ALPHABET_SIZE>
+    static auto count(const char * buf, size_t sz, dg::thread_pool::WorkStealingPool& pool, size_t sample_stride) -> std::vector<size_t>{
+
+        if (sample_stride == 0u){
+            std::abort();
+        }
+
+        auto blk_count      = (sz + constants::COUNT_BLOCK_SZ - 1) / constants::COUNT_BLOCK_SZ;
+        auto sampled_count  = (blk_count + sample_stride - 1) / sample_stride;
+        auto partition_sz   = std::max(size_t{1u}, std::min(pool.size(), sampled_count));
+        auto partial        = std::vector<std::vector<size_t>>(partition_sz);
+
+        pool.parallel_for(partition_sz, [&](size_t idx){
+            auto counter = make_histogram_counter<ALPHABET_SIZE>();
+
+            for (size_t i = idx; i < sampled_count; i += partition_sz){
+                auto offs = i * sample_stride * constants::COUNT_BLOCK_SZ;
+                count_into<ALPHABET_SIZE>(buf + offs, std::min(constants::COUNT_BLOCK_SZ, sz - offs), counter);
+            }
+
+            flush<ALPHABET_SIZE>(counter);
+            partial[idx] = std::move(counter.total);
+        });
+
+        auto rs = std::vector<size_t>(constants::DICT_SIZE<ALPHABET_SIZE>, size_t{0u});
+
+        for (const auto& counter: partial){
+            std::transform(rs.begin(), rs.end(), counter.begin(), rs.begin(), std::plus<size_t>{});
+        }
+
+        return rs;
+    }
+
+    static auto clamp(std::vector<size_t> count){
+        
+        const auto MMIN     = size_t{1u};
+        auto transformer    = [=](size_t count){return std::max(MMIN, count);}; 
+        std::transform(count.begin(), count.end(), count.begin(), transformer);
+
+        return count;
+    }
+
+    static auto sort_by_count(const std::vector<size_t>& counter) -> std::vector<size_t>{
+
+        auto rs = std::vector<size_t>(counter.size());
+        std::iota(rs.begin(), rs.end(), size_t{0u});
+        std::stable_sort(rs.begin(), rs.end(), [&](size_t lhs, size_t rhs){return counter[lhs] < counter[rhs];});
+
+        return rs;
+    }
+
+    //two-queue construction over the sorted leaves - merged weights come out non-decreasing, so no heap is needed
+    static auto huffman_length(const std::vector<size_t>& counter) -> std::vector<size_t>{
+
+        auto sz         = counter.size();
+        auto sorted_idx = sort_by_count(counter);
+        auto weight     = std::vector<size_t>(sz * 2 - 1);
+        auto parent     = std::vector<size_t>(sz * 2 - 1);
+        auto depth      = std::vector<size_t>(sz * 2 - 1);
+        auto leaf_idx   = size_t{0u};
+        auto merged_idx = sz;
+
+        for (size_t i = 0; i < sz; ++i){
+            weight[i] = counter[sorted_idx[i]];
+        }
+
+        auto pop_min = [&](size_t last){
+            if (leaf_idx < sz && (merged_idx == last || weight[leaf_idx] <= weight[merged_idx])){
+                return leaf_idx++;
+            }
+            return merged_idx++;
+        };
+
+        for (size_t i = sz; i < sz * 2 - 1; ++i){
+            auto first  = pop_min(i);
+            auto second = pop_min(i);
+            weight[i]       = weight[first] + weight[second];
+            parent[first]   = i;
+            parent[second]  = i;
+        }
+
+        depth.back() = 0u;
+
+        for (size_t i = sz * 2 - 1; i-- > 1;){
+            depth[i - 1] = depth[parent[i - 1]] + 1;
+        }
+
+        auto rs = std::vector<size_t>(sz);
+
+        for (size_t i = 0; i < sz; ++i){
+            rs[sorted_idx[i]] = depth[i];
+        }
+
+        return rs;
+    }
+
+    static auto package_merge(const std::vector<size_t>& counter, size_t max_length) -> std::vector<size_t>{
+
+        auto sz             = counter.size();
+        auto sorted_idx     = sort_by_count(counter);
+        auto leaf_weight    = utility::vector_transform(sorted_idx, [&](size_t idx){return counter[idx];});
+        auto weight         = leaf_weight;
+        auto is_package     = std::vector<std::vector<bool>>(max_length);
+        is_package.back()   = std::vector<bool>(sz, false);
+
+        for (size_t lvl = max_length - 1; lvl != 0; --lvl){
+            auto pkg_sz     = weight.size() / 2;
+            auto merged     = std::vector<size_t>{};
+            auto flag       = std::vector<bool>{};
+            size_t i        = 0u;
+            size_t j        = 0u;
+            merged.reserve(sz + pkg_sz);
+            flag.reserve(sz + pkg_sz);
+
+            while (i < sz || j < pkg_sz){
+                if (j == pkg_sz || (i < sz && leaf_weight[i] <= weight[j * 2] + weight[j * 2 + 1])){
+                    merged.push_back(leaf_weight[i++]);
+                    flag.push_back(false);
+                } else{
+                    merged.push_back(weight[j * 2] + weight[j * 2 + 1]);
+                    flag.push_back(true);
+                    ++j;
+                }
+            }
+
+            is_package[lvl - 1] = std::move(flag);
+            weight              = std::move(merged);
+        }
+
+        auto rs     = std::vector<size_t>(sz, size_t{0u});
+        auto take   = sz * 2 - 2;
+
+        for (size_t lvl = 0; lvl < max_length; ++lvl){
+            auto pkg_sz     = static_cast<size_t>(std::count(is_package[lvl].begin(), std::next(is_package[lvl].begin(), take), true));
+            auto leaf_sz    = take - pkg_sz;
+
+            for (size_t i = 0; i < leaf_sz; ++i){
+                rs[sorted_idx[i]] += 1;
+            }
+
+            take = pkg_sz * 2;
+        }
+
+        return rs;
+    }
+
+    template <size_t ALPHABET_SIZE>
+    static auto to_canonical_tree(const std::vector<size_t>& code_length) -> model::Tree{
+
+        auto max_length = *std::max_element(code_length.begin(), code_length.end());
+        auto level      = std::vector<std::vector<uint32_t>>(max_length + 1);
+        auto rs         = model::Tree{};
+        rs.node.reserve((constants::DICT_SIZE<ALPHABET_SIZE> + ALPHABET_SIZE) * 2);
+
+        for (size_t i = 0; i < constants::DICT_SIZE<ALPHABET_SIZE>; ++i){
+            auto num_rep    = static_cast<num_rep_type<ALPHABET_SIZE>>(i);
+            auto word       = word_type{};
+            dg::compact_serializer::core::serialize(num_rep, word.data());
+            level[code_length[i]].push_back(static_cast<uint32_t>(rs.node.size()));
+            rs.node.push_back(model::TreeNode{model::NIL_IDX, model::NIL_IDX, word, 0u});
+        }
+
+        for (size_t depth = max_length; depth != 0; --depth){
+            if (level[depth].size() % 2 != 0){
+                std::abort();
+            }
+
+            for (size_t i = 0; i < level[depth].size(); i += 2){
+                level[depth - 1].push_back(static_cast<uint32_t>(rs.node.size()));
+                rs.node.push_back(model::TreeNode{level[depth][i], level[depth][i + 1], {}, 0u});
+            }
+        }
+
+        if (level.front().size() != 1){
+            std::abort();
+        }
+
+        rs.root = level.front().back();
+        return rs;
+    }
+
+    template <size_t ALPHABET_SIZE>
+    static auto build(std::vector<size_t> counter, size_t max_code_length) -> model::Tree{
+
+        //to_delim_tree splits the shallowest leaves - with symbols within max_code_length - 1 the split leaves stay within max_code_length
+        auto max_symbol_length  = max_code_length - 1;
+
+        if (counter.size() != constants::DICT_SIZE<ALPHABET_SIZE>){
+            std::abort();
+        } 
+
+        if (max_code_length > constants::MAX_CODE_LENGTH || max_symbol_length >= std::numeric_limits<size_t>::digits || (size_t{1} << max_symbol_length) < constants::DICT_SIZE<ALPHABET_SIZE>){
+            std::abort();
+        }
+
+        //package-merge only when the unrestricted code overflows - both are optimal otherwise
+        auto code_length = huffman_length(counter);
+
+        if (*std::max_element(code_length.begin(), code_length.end()) > max_symbol_length){
+            code_length = package_merge(counter, max_symbol_length);
+        }
+
+        return to_canonical_tree<ALPHABET_SIZE>(code_length);
+    }
+
+    //converts a model stored as a model::Node graph - nodes come out in preorder, left subtree first
+    static auto to_tree(model::Node * root) -> model::Tree{
+
+        using dg::compact_serializer::runtime_exception::CorruptedError;
+
+        auto rs     = model::Tree{};
+        auto stack  = std::vector<std::tuple<model::Node *, uint32_t, bool>>{{root, model::NIL_IDX, constants::L}}; //node, parent, side
+
+        while (!stack.empty()){
+            auto [node, parent, side]   = stack.back();
+            auto idx                    = static_cast<uint32_t>(rs.node.size());
+            stack.pop_back();
+
+            if (static_cast<bool>(node->l) != static_cast<bool>(node->r)){
+                throw CorruptedError{};
+            }
+
+            rs.node.push_back(model::TreeNode{model::NIL_IDX, model::NIL_IDX, node->c, 0u});
+
+            if (parent == model::NIL_IDX){
+                rs.root = idx;
+            } else if (side == constants::L){
+                rs.node[parent].l = idx;
+            } else{
+                rs.node[parent].r = idx;
+            }
+
+            if (node->l){
+                stack.push_back({node->r.get(), idx, constants::R});
+                stack.push_back({node->l.get(), idx, constants::L});
+            }
+        }
+
+        return rs;
+    }
+
+    static auto extend(bit_array_type trace, bool bit) -> bit_array_type{
+
+        bit_array::append(trace, bit_array::to_bit_array(bit));
+        return trace;
+    }
+
+    template <size_t ALPHABET_SIZE>
+    static auto to_code_length(const model::Tree& tree) -> std::vector<size_t>{
+
+        auto rs     = std::vector<size_t>(constants::DICT_SIZE<ALPHABET_SIZE>);
+        auto stack  = std::vector<std::pair<uint32_t, size_t>>{{tree.root, size_t{0u}}};
+
+        while (!stack.empty()){
+            auto [idx, depth]   = stack.back();
+            const auto& node    = tree.node[idx];
+            stack.pop_back();
+
+            if (model::is_leaf(node)){
+                auto num_rep    = num_rep_type<ALPHABET_SIZE>{};
+                dg::compact_serializer::core::deserialize(node.c.data(), num_rep);
+                rs[num_rep]     = depth;
+            } else{
+                stack.push_back({node.l, depth + 1});
+                stack.push_back({node.r, depth + 1});
+            }
+        }
+
+        return rs;
+    }
+
+    //(length, LEB128 run) pairs - or, when every length is within 15 of the shortest, a base length followed by 4-bit deltas
+    static auto pack_code_length(const std::vector<size_t>& code_length) -> model::CodeLengthModel{
+
+        auto [min_it, max_it]   = std::minmax_element(code_length.begin(), code_length.end());
+        auto rle                = model::CodeLengthModel{constants::RLE_CODE_LENGTH, {}};
+
+        for (size_t i = 0; i < code_length.size();){
+            auto run = static_cast<size_t>(std::distance(code_length.begin() + i, std::find_if(code_length.begin() + i, code_length.end(), [&](size_t len){return len != code_length[i];})));
+            rle.payload.push_back(static_cast<uint8_t>(code_length[i]));
+            i += run;
+
+            while (run >= 0x80u){
+                rle.payload.push_back(static_cast<uint8_t>(run | 0x80u));
+                run >>= 7;
+            }
+
+            rle.payload.push_back(static_cast<uint8_t>(run));
+        }
+
+        if (*max_it - *min_it > 0x0Fu){
+            return rle;
+        }
+
+        auto nibble = model::CodeLengthModel{constants::NIBBLE_CODE_LENGTH, {static_cast<uint8_t>(*min_it)}};
+        nibble.payload.resize(1u + (code_length.size() + 1) / 2);
+
+        for (size_t i = 0; i < code_length.size(); ++i){
+            nibble.payload[1u + i / 2] |= static_cast<uint8_t>((code_length[i] - *min_it) << ((i % 2) * 4));
+        }
+
+        if (nibble.payload.size() < rle.payload.size()){
+            return nibble;
+        }
+
+        return rle;
+    }
+
+    template <size_t ALPHABET_SIZE>
+    static auto unpack_code_length(const model::CodeLengthModel& model) -> std::vector<size_t>{
+
+        using dg::compact_serializer::runtime_exception::CorruptedError;
+        auto rs = std::vector<size_t>{};
+
+        if (model.encoding == constants::RLE_CODE_LENGTH){
+            for (size_t i = 0; i < model.payload.size();){
+                auto len    = size_t{model.payload[i++]};
+                auto run    = size_t{0u};
+                auto shift  = size_t{0u};
+
+                while (true){
+                    if (i == model.payload.size() || shift >= std::numeric_limits<size_t>::digits){
+                        throw CorruptedError{};
+                    }
+
+                    auto byte   = model.payload[i++];
+                    run         |= static_cast<size_t>(byte & 0x7Fu) << shift;
+                    shift       += 7;
+
+                    if ((byte & 0x80u) == 0u){
+                        break;
+                    }
+                }
+
+                if (run > constants::DICT_SIZE<ALPHABET_SIZE> - rs.size()){
+                    throw CorruptedError{};
+                }
+
+                rs.insert(rs.end(), run, len);
+            }
+        } else if (model.encoding == constants::NIBBLE_CODE_LENGTH){
+            if (model.payload.size() != 1u + (constants::DICT_SIZE<ALPHABET_SIZE> + 1) / 2){
+                throw CorruptedError{};
+            }
+
+            rs.resize(constants::DICT_SIZE<ALPHABET_SIZE>);
+
+            for (size_t i = 0; i < constants::DICT_SIZE<ALPHABET_SIZE>; ++i){
+                rs[i] = size_t{model.payload.front()} + ((model.payload[1u + i / 2] >> ((i % 2) * 4)) & 0x0Fu);
+            }
+        } else{
+            throw CorruptedError{};
+        }
+
+        if (rs.size() != constants::DICT_SIZE<ALPHABET_SIZE>){
+            throw CorruptedError{};
+        }
+
+        //lengths must describe a full tree that fits the canonical decoder - Kraft sum of exactly one
+        auto kraft = uint64_t{0u};
+
+        for (size_t len: rs){
+            if (len == 0u || len >= constants::MAX_CODE_LENGTH){
+                throw CorruptedError{};
+            }
+
+            kraft += uint64_t{1} << (constants::MAX_CODE_LENGTH - len);
+        }
+
+        if (kraft != (uint64_t{1} << constants::MAX_CODE_LENGTH)){
+            throw CorruptedError{};
+        }
+
+        return rs;
+    }
+
+    template <size_t ALPHABET_SIZE>
+    static auto encode_dictionarize(const model::Tree& tree) -> std::vector<bit_array_type>{
+
+        auto rs     = std::vector<bit_array_type>(constants::DICT_SIZE<ALPHABET_SIZE>);
+        auto stack  = std::vector<std::pair<uint32_t, bit_array_type>>{{tree.root, bit_array_type{}}};
+
+        while (!stack.empty()){
+            auto [idx, trace]   = stack.back();
+            const auto& node    = tree.node[idx];
+            stack.pop_back();
+
+            if (model::is_leaf(node)){
+                if (!node.delim_stat){
+                    auto num_rep    = num_rep_type<ALPHABET_SIZE>{};
+                    dg::compact_serializer::core::deserialize(node.c.data(), num_rep);
+                    rs[num_rep]     = trace;
+                }
+            } else{
+                stack.push_back({node.l, extend(trace, constants::L)});
+                stack.push_back({node.r, extend(trace, constants::R)});
+            }
+        }
+
+        return rs;
+    }
+    
+    template <size_t ALPHABET_SIZE>
+    static auto decode_dictionarize(const model::Tree& tree) -> std::vector<model::DecodeEntry>{
+
+        auto rs = std::vector<model::DecodeEntry>(constants::DECODE_TABLE_SIZE);
+
+        for (size_t i = 0; i < constants::DECODE_TABLE_SIZE; ++i){
+            auto entry  = model::DecodeEntry{};
+            auto cursor = tree.root;
+
+            for (size_t j = 0; j < constants::DECODE_TABLE_BIT_SIZE; ++j){
+                if (static_cast<bool>((i >> j) & 1u) == constants::L){
+                    cursor = tree.node[cursor].l;
+                } else{
+                    cursor = tree.node[cursor].r;
+                }
+
+                const auto& node = tree.node[cursor];
+
+                if (model::is_leaf(node)){
+                    if (node.delim_stat || entry.byte_sz + ALPHABET_SIZE > constants::DECODE_ENTRY_BYTE_CAP){
+                        break;
+                    }
+
+                    std::memcpy(entry.bytes.data() + entry.byte_sz, node.c.data(), ALPHABET_SIZE);
+                    entry.byte_sz   += ALPHABET_SIZE;
+                    entry.bit_sz    = j + 1;
+                    cursor          = tree.root;
+                }
+            }
+
+            rs[i] = entry;
+        }
+
+        return rs;
+    }
+
+    //rightmost leaf of the shallowest level that has one
+    static auto find_min_path_to_leaf(const model::Tree& tree) -> uint32_t{
+
+        auto level = std::vector<uint32_t>{tree.root};
+
+        while (true){
+            auto leaf = std::find_if(level.rbegin(), level.rend(), [&](uint32_t idx){return model::is_leaf(tree.node[idx]);});
+
+            if (leaf != level.rend()){
+                return *leaf;
+            }
+
+            auto next_level = std::vector<uint32_t>{};
+
+            for (auto idx: level){
+                next_level.push_back(tree.node[idx].l);
+                next_level.push_back(tree.node[idx].r);
+            }
+
+            level = std::move(next_level);
+        }
+    }
+
+    static void split_min_path_leaf(model::Tree& tree, uint8_t delim_stat){
+
+        auto leaf   = find_min_path_to_leaf(tree);
+        auto l      = static_cast<uint32_t>(tree.node.size());
+        auto r      = static_cast<uint32_t>(tree.node.size() + 1);
+        auto c      = tree.node[leaf].c;
+        auto stat   = tree.node[leaf].delim_stat;
+
+        tree.node.push_back(model::TreeNode{model::NIL_IDX, model::NIL_IDX, c, stat});
+        tree.node.push_back(model::TreeNode{model::NIL_IDX, model::NIL_IDX, {}, delim_stat});
+        tree.node[leaf].l = l;
+        tree.node[leaf].r = r;
+    }
+
+    //the rle escape, if any, is split in after the delimiters
+    template <size_t ALPHABET_SIZE>
+    static auto to_delim_tree(model::Tree tree, bool escape) -> model::Tree{
+
+        for (size_t i = 0; i < ALPHABET_SIZE; ++i){
+            split_min_path_leaf(tree, static_cast<uint8_t>(i + 1));
+        }
+
+        if (escape){
+            split_min_path_leaf(tree, model::ESCAPE_STAT);
+        }
+
+        return tree;
+    } 
+
+    template <size_t ALPHABET_SIZE>
+    static auto find_delim(const model::Tree& tree) -> std::vector<bit_array_type>{
+
+        auto rs     = std::vector<bit_array_type>(ALPHABET_SIZE);
+        auto stack  = std::vector<std::pair<uint32_t, bit_array_type>>{{tree.root, bit_array_type{}}};
+
+        while (!stack.empty()){
+            auto [idx, trace]   = stack.back();
+            const auto& node    = tree.node[idx];
+            stack.pop_back();
+
+            if (model::is_leaf(node)){
+                if (node.delim_stat && node.delim_stat != model::ESCAPE_STAT){
+                    rs[node.delim_stat - 1] = trace;
+                }
+            } else{
+                stack.push_back({node.l, extend(trace, constants::L)});
+                stack.push_back({node.r, extend(trace, constants::R)});
+            }
+        }
+
+        return rs;
+    }
+
+    //empty if the tree has no rle escape
+    static auto find_escape(const model::Tree& tree) -> std::vector<bit_array_type>{
+
+        auto rs     = std::vector<bit_array_type>{};
+        auto stack  = std::vector<std::pair<uint32_t, bit_array_type>>{{tree.root, bit_array_type{}}};
+
+        while (!stack.empty()){
+            auto [idx, trace]   = stack.back();
+            const auto& node    = tree.node[idx];
+            stack.pop_back();
+
+            if (model::is_leaf(node)){
+                if (node.delim_stat == model::ESCAPE_STAT){
+                    rs.push_back(trace);
+                }
+            } else{
+                stack.push_back({node.l, extend(trace, constants::L)});
+                stack.push_back({node.r, extend(trace, constants::R)});
+            }
+        }
+
+        return rs;
+    }
+
+    //leaves grouped by depth, each group in increasing code order
+    static auto find_leaf(const model::Tree& tree) -> std::vector<std::vector<std::pair<uint64_t, model::DelimLeaf>>>{
+
+        auto rs     = std::vector<std::vector<std::pair<uint64_t, model::DelimLeaf>>>{};
+        auto stack  = std::vector<std::tuple<uint32_t, size_t, uint64_t>>{{tree.root, size_t{0u}, uint64_t{0u}}};
+
+        while (!stack.empty()){
+            auto [idx, depth, code] = stack.back();
+            const auto& node        = tree.node[idx];
+            stack.pop_back();
+
+            if (model::is_leaf(node)){
+                if (rs.size() <= depth){
+                    rs.resize(depth + 1);
+                }
+                rs[depth].push_back({code, model::DelimLeaf{node.c, node.delim_stat}});
+            } else{
+                stack.push_back({node.r, depth + 1, (code << 1) | static_cast<uint64_t>(constants::R)});
+                stack.push_back({node.l, depth + 1, (code << 1) | static_cast<uint64_t>(constants::L)});
+            }
+        }
+
+        return rs;
+    }
+
+    static auto max_depth(const model::Tree& tree) -> size_t{
+
+        auto rs     = size_t{0u};
+        auto stack  = std::vector<std::pair<uint32_t, size_t>>{{tree.root, size_t{0u}}};
+
+        while (!stack.empty()){
+            auto [idx, depth]   = stack.back();
+            const auto& node    = tree.node[idx];
+            stack.pop_back();
+
+            if (model::is_leaf(node)){
+                rs = std::max(rs, depth);
+            } else{
+                stack.push_back({node.l, depth + 1});
+                stack.push_back({node.r, depth + 1});
+            }
+        }
+
+        return rs;
+    }
+
+    static auto to_canonical_table(const model::Tree& tree) -> model::CanonicalTable{
+
+        auto leaf_by_length = find_leaf(tree);
+
+        if (leaf_by_length.size() > constants::MAX_CODE_LENGTH + 1){
+            return {};
+        }
+
+        auto rs         = model::CanonicalTable{};
+        auto first      = uint64_t{0u};
+        rs.limit        = std::vector<uint64_t>(leaf_by_length.size());
+        rs.offset       = std::vector<size_t>(leaf_by_length.size());
+        rs.min_length   = 0u;
+        rs.max_length   = leaf_by_length.size() - 1;
+
+        for (size_t len = 1; len < leaf_by_length.size(); ++len){
+            const auto& leaf = leaf_by_length[len];
+
+            for (size_t i = 0; i < leaf.size(); ++i){
+                if (leaf[i].first != first + i){
+                    return {};
+                }
+                rs.leaf.push_back(leaf[i].second);
+            }
+
+            if (rs.min_length == 0u && !leaf.empty()){
+                rs.min_length = len;
+            }
+
+            rs.offset[len]  = rs.leaf.size() - leaf.size() - first;
+            rs.limit[len]   = (first + leaf.size()) << (constants::MAX_CODE_LENGTH - len);
+            first           = (first + leaf.size()) << 1;
+        }
+
+        return rs;
+    }
+
+    //engine image of a delim tree with the tables of role only - an encode image carries no tree and no decode tables,
+    //a decode image no codes
+    //codes longer than MAX_CODE_LENGTH bits throw CorruptedError, as image::verify would reject the image
+    template <size_t ALPHABET_SIZE>
+    static auto to_image(const model::Tree& delim_tree, uint64_t role, memory::ImageAllocator& allocator) -> std::pair<std::shared_ptr<char>, size_t>{
+
+        if (max_depth(delim_tree) > constants::MAX_CODE_LENGTH){
+            throw runtime_exception::CorruptedError{};
+        }
+
+        auto has_encode             = (role & image::ENCODE_ROLE) != 0u;
+        auto has_decode             = (role & image::DECODE_ROLE) != 0u;
+        auto encoding_dict          = has_encode ? encode_dictionarize<ALPHABET_SIZE>(delim_tree) : std::vector<bit_array_type>{};
+        auto delim                  = has_encode ? find_delim<ALPHABET_SIZE>(delim_tree) : std::vector<bit_array_type>{};
+        auto escape                 = has_encode ? find_escape(delim_tree) : std::vector<bit_array_type>{};
+        auto tree_node              = has_decode ? std::span<const model::TreeNode>(delim_tree.node) : std::span<const model::TreeNode>{};
+        auto decoding_dict          = has_decode ? decode_dictionarize<ALPHABET_SIZE>(delim_tree) : std::vector<model::DecodeEntry>{};
+        auto canonical_table        = has_decode ? to_canonical_table(delim_tree) : model::CanonicalTable{};
+        auto packed_encoding_dict   = std::vector<model::EncodeEntry>{};
+
+        auto header                     = image::Header{};
+        auto offs                       = sizeof(image::Header);
+        header.magic                    = image::MAGIC;
+        header.version                  = image::VERSION;
+        header.alphabet_sz              = ALPHABET_SIZE;
+        header.role                     = role;
+        header.tree_root                = has_decode ? delim_tree.root : 0u;
+        header.canonical_min_length     = canonical_table.min_length;
+        header.canonical_max_length     = canonical_table.max_length;
+
+        for (const auto& bit_rep: encoding_dict){
+            header.encoding_max_length = std::max(header.encoding_max_length, static_cast<uint64_t>(bit_array::size(bit_rep)));
+        }
+
+        auto is_packed = header.encoding_max_length <= constants::PACKED_ENCODE_MAX_LENGTH;
+
+        if (is_packed){
+            std::transform(encoding_dict.begin(), encoding_dict.end(), std::back_inserter(packed_encoding_dict), model::to_encode_entry);
+        }
+
+        header.encoding_dict            = image::make_section<bit_array_type>(offs, is_packed ? 0u : encoding_dict.size());
+        header.packed_encoding_dict     = image::make_section<model::EncodeEntry>(offs, packed_encoding_dict.size());
+        header.delim                    = image::make_section<bit_array_type>(offs, delim.size());
+        header.escape                   = image::make_section<bit_array_type>(offs, escape.size());
+        header.tree_node                = image::make_section<model::TreeNode>(offs, tree_node.size());
+        header.decoding_dict            = image::make_section<model::DecodeEntry>(offs, decoding_dict.size());
+        header.canonical_limit          = image::make_section<uint64_t>(offs, canonical_table.limit.size());
+        header.canonical_offset         = image::make_section<size_t>(offs, canonical_table.offset.size());
+        header.canonical_leaf           = image::make_section<model::DelimLeaf>(offs, canonical_table.leaf.size());
+        header.image_sz                 = image::align(offs);
+
+        auto buf = allocator.allocate(header.image_sz);
+        std::memset(buf.get(), 0, header.image_sz);
+        image::write_section<bit_array_type>(buf.get(), header.encoding_dict, std::span<const bit_array_type>(encoding_dict).first(header.encoding_dict.sz));
+        image::write_section<model::EncodeEntry>(buf.get(), header.packed_encoding_dict, packed_encoding_dict);
+        image::write_section<bit_array_type>(buf.get(), header.delim, delim);
+        image::write_section<bit_array_type>(buf.get(), header.escape, escape);
+        image::write_section<model::TreeNode>(buf.get(), header.tree_node, tree_node);
+        image::write_section<model::DecodeEntry>(buf.get(), header.decoding_dict, decoding_dict);
+        image::write_section<uint64_t>(buf.get(), header.canonical_limit, canonical_table.limit);
+        image::write_section<size_t>(buf.get(), header.canonical_offset, canonical_table.offset);
+        image::write_section<model::DelimLeaf>(buf.get(), header.canonical_leaf, canonical_table.leaf);
+        header.checksum = image::checksum(buf.get(), header.image_sz);
+        std::memcpy(buf.get(), &header, sizeof(image::Header));
+
+        return {std::move(buf), header.image_sz};
+    }
+}
+
+namespace dg::huffman_encoder::core{
+    
+    using namespace types;
+
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    class FastEngine;
+
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    class EncodeEngine;
+
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    class DecodeEngine;
+
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    class StreamEncoder;
+
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    class StreamDecoder;
+
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    class FrameEngine;
+
+    template <size_t ALPHABET_SIZE>
+    class FastEngine{
+
+        private:
+
+            friend class StreamEncoder<ALPHABET_SIZE>;
+            friend class StreamDecoder<ALPHABET_SIZE>;
+
+            std::shared_ptr<const void> storage; //keeps the image alive - null for an unowned view
+            const char * image;
+            size_t image_sz;
+            std::span<const bit_array_type> encoding_dict;              //one of the two is empty - see image::Header
+            std::span<const model::EncodeEntry> packed_encoding_dict;
+            std::span<const bit_array_type> delim;
+            std::span<const bit_array_type> escape;
+            model::TreeView delim_tree;
+            std::span<const model::DecodeEntry> decoding_dict;
+            model::CanonicalView canonical_table;
+            bool is_pairable;
+
+        public:
+
+            //image must have passed image::verify
+            FastEngine(std::shared_ptr<const void> storage, 
+                       const char * image): storage(std::move(storage)),
+                                            image(image){
+                
+                auto header                         = image::read_header(image);
+                this->image_sz                      = header.image_sz;
+                this->encoding_dict                 = image::view_section<bit_array_type>(image, header.encoding_dict);
+                this->packed_encoding_dict          = image::view_section<model::EncodeEntry>(image, header.packed_encoding_dict);
+                this->delim                         = image::view_section<bit_array_type>(image, header.delim);
+                this->escape                        = image::view_section<bit_array_type>(image, header.escape);
+                this->delim_tree.node               = image::view_section<model::TreeNode>(image, header.tree_node);
+                this->delim_tree.root               = static_cast<uint32_t>(header.tree_root);
+                this->decoding_dict                 = image::view_section<model::DecodeEntry>(image, header.decoding_dict);
+                this->canonical_table.limit         = image::view_section<uint64_t>(image, header.canonical_limit);
+                this->canonical_table.offset        = image::view_section<size_t>(image, header.canonical_offset);
+                this->canonical_table.leaf          = image::view_section<model::DelimLeaf>(image, header.canonical_leaf);
+                this->canonical_table.min_length    = header.canonical_min_length;
+                this->canonical_table.max_length    = header.canonical_max_length;
+                this->is_pairable                   = header.encoding_max_length <= constants::ENCODE_PAIR_MAX_LENGTH;
+            }
+
+            auto get_image() const noexcept -> std::pair<const char *, size_t>{
+
+                return {this->image, this->image_sz};
+            }
+
+            auto has_escape() const noexcept -> bool{
+
+                return !this->escape.empty();
+            }
+             
+            //with an rle escape, a repeat of the previous symbol is coded as escape + LEB128 repeat count whenever that is shorter
+            auto noexhaust_encode_into(const char * inp_buf, size_t inp_sz, char * op_buf, bit_array_type& rdbuf) const noexcept -> char *{
+                
+                size_t cycles   = inp_sz / ALPHABET_SIZE; 
+                size_t rem      = inp_sz - (cycles * ALPHABET_SIZE);
+                auto ibuf       = inp_buf;
+
+                if (!this->has_escape()){
+                    //every symbol takes at least a bit, so a tail of ENCODE_KERNEL_TAIL_SZ symbols covers the kernel's word stores
+                    auto kernel_cycles  = (cycles > constants::ENCODE_KERNEL_TAIL_SZ) ? cycles - constants::ENCODE_KERNEL_TAIL_SZ : size_t{0u};
+                    std::tie(ibuf, op_buf) = this->visit_encoding_dict([&](auto dict){return encode_kernel::encode<ALPHABET_SIZE>(dict.data(), ibuf, kernel_cycles, op_buf, rdbuf, this->is_pairable);});
+
+                    for (size_t i = kernel_cycles; i < cycles; ++i){
+                        auto num_rep    = num_rep_type<ALPHABET_SIZE>{};
+                        ibuf            = dg::compact_serializer::core::deserialize(ibuf, num_rep);
+                        op_buf          = bit_stream::stream_to(op_buf, this->encoding(num_rep), rdbuf);
+                    }
+                } else{
+                    for (size_t i = 0; i < cycles;){
+                        auto num_rep    = num_rep_type<ALPHABET_SIZE>{};
+                        ibuf            = dg::compact_serializer::core::deserialize(ibuf, num_rep);
+                        auto bit_rep    = this->encoding(num_rep);
+                        auto repeat_sz  = this->repeat_size(ibuf, cycles - i - 1u);
+                        op_buf          = bit_stream::stream_to(op_buf, bit_rep, rdbuf);
+                        ibuf            += repeat_sz * ALPHABET_SIZE;
+                        i               += repeat_sz + 1u;
+
+                        if (this->is_run(bit_rep, repeat_sz)){
+                            op_buf = this->stream_run_to(op_buf, repeat_sz, rdbuf);
+                            continue;
+                        }
+
+                        for (size_t j = 0; j < repeat_sz; ++j){
+                            op_buf = bit_stream::stream_to(op_buf, bit_rep, rdbuf);
+                        }
+                    }
+                }
+
+                op_buf  = bit_stream::stream_to(op_buf, this->delim[rem], rdbuf);
+
+                for (size_t i = 0; i < rem; ++i){
+                    op_buf  = bit_stream::stream_to(op_buf, bit_array::to_bit_array(ibuf[i]), rdbuf);
+                }
+                                
+                return op_buf;
+            }
+            
+            auto encode_into(const char * inp_buf, size_t inp_sz, char * op_buf, bit_array_type& rdbuf) const noexcept -> char *{
+
+                return bit_stream::exhaust_to(noexhaust_encode_into(inp_buf, inp_sz, op_buf, rdbuf), rdbuf);
+            }
+
+            auto encoded_bit_size(const char * inp_buf, size_t inp_sz) const noexcept -> size_t{
+
+                size_t cycles   = inp_sz / ALPHABET_SIZE; 
+                size_t rem      = inp_sz - (cycles * ALPHABET_SIZE);
+                auto ibuf       = inp_buf;
+                auto rs         = bit_array::size(this->delim[rem]) + rem * CHAR_BIT;
+
+                if (!this->has_escape()){
+                    return this->visit_encoding_dict([&](auto dict){
+                        for (size_t i = 0; i < cycles; ++i){
+                            auto num_rep    = num_rep_type<ALPHABET_SIZE>{};
+                            ibuf            = dg::compact_serializer::core::deserialize(ibuf, num_rep);
+                            rs              += encode_kernel::length(dict[num_rep]);
+                        }
+
+                        return rs;
+                    });
+                }
+
+                for (size_t i = 0; i < cycles;){
+                    auto num_rep    = num_rep_type<ALPHABET_SIZE>{};
+                    ibuf            = dg::compact_serializer::core::deserialize(ibuf, num_rep);
+                    auto bit_rep    = this->encoding(num_rep);
+                    auto repeat_sz  = this->repeat_size(ibuf, cycles - i - 1u);
+                    ibuf            += repeat_sz * ALPHABET_SIZE;
+                    i               += repeat_sz + 1u;
+                    rs              += bit_array::size(bit_rep) + (this->is_run(bit_rep, repeat_sz) ? this->run_bit_size(repeat_sz) : bit_array::size(bit_rep) * repeat_sz);
+                }
+
+                return rs;
+            }
+
+            auto encoded_size(const char * inp_buf, size_t inp_sz) const noexcept -> size_t{
+
+                return byte_array::byte_size(this->encoded_bit_size(inp_buf, inp_sz));
+            }
+
+            //upper bound from a make::count histogram of the input - the histogram carries no odd trailing byte, so the longest delimiter is assumed
+            auto encoded_bit_size_bound(const std::vector<size_t>& counter) const noexcept -> size_t{
+
+                auto rs = size_t{0u};
+
+                for (size_t i = 0; i < ALPHABET_SIZE; ++i){
+                    rs = std::max(rs, bit_array::size(this->delim[i]) + i * CHAR_BIT);
+                }
+
+                for (size_t i = 0; i < counter.size(); ++i){
+                    rs += counter[i] * bit_array::size(this->encoding(i));
+                }
+
+                return rs;
+            }
+
+            //encode_into an exactly sized buffer - returns {buf, buf_sz}
+            auto encode(const char * inp_buf, size_t inp_sz) const -> std::pair<std::unique_ptr<char[]>, size_t>{
+
+                auto sz     = this->encoded_size(inp_buf, inp_sz);
+                auto buf    = std::unique_ptr<char[]>(new char[sz]);
+                auto rdbuf  = bit_array_type{};
+                this->encode_into(inp_buf, inp_sz, buf.get(), rdbuf);
+
+                return {std::move(buf), sz};
+            }
+            
+            auto fast_decode_into(const char * inp_buf, size_t bit_offs, size_t bit_last, char * op_buf) const noexcept -> std::pair<size_t, char *>{
+
+                auto stats = stats::NoStats{};
+                return this->fast_decode_into(inp_buf, bit_offs, bit_last, op_buf, stats);
+            }
+
+            //REVIEW:
+            template <class Stats>
+            auto fast_decode_into(const char * inp_buf, size_t bit_offs, size_t bit_last, char * op_buf, Stats& stats) const noexcept -> std::pair<size_t, char *>{
+                
+                const auto& node    = this->delim_tree.node;
+                auto cursor         = this->delim_tree.root;
+                auto root           = this->delim_tree.root;
+                auto bad_bit        = bool{false};
+                auto bit_first      = bit_offs;
+                auto op_first       = op_buf;
+                 
+                while (true){
+
+                    bool table_prereq       = (bit_offs + bit_stream::read_padd_requirement() < bit_last) && (cursor == root);
+                    bool dictionary_prereq  = table_prereq && (!bad_bit);
+                    bool canonical_prereq   = table_prereq && (this->canonical_table.max_length != 0u);
+
+                    if (dictionary_prereq){
+                        auto tape           = bit_stream::read(inp_buf, bit_offs, std::integral_constant<size_t, constants::DECODE_TABLE_BIT_SIZE>{});
+                        const auto& entry   = this->decoding_dict[tape];
+                        std::memcpy(op_buf, entry.bytes.data(), entry.byte_sz);
+                        op_buf   += entry.byte_sz;
+                        bit_offs += entry.bit_sz;
+                        bad_bit  = entry.bit_sz == 0u;
+                        stats.table(entry.bit_sz, entry.byte_sz / ALPHABET_SIZE);
+                    } else if (canonical_prereq){
+                        //the leading code is either longer than the dictionary peek or a delimiter - resolve it in one canonical lookup
+                        bad_bit             = false;
+                        const auto& leaf    = this->canonical_read(inp_buf, bit_offs);
+                        stats.canonical(leaf.delim_stat != 0u);
+
+                        if (leaf.delim_stat == model::ESCAPE_STAT){
+                            op_buf = this->expand_run(inp_buf, bit_offs, op_buf, stats);
+                            continue;
+                        }
+
+                        if (leaf.delim_stat){
+                            auto trailing_sz    = leaf.delim_stat - 1;
+                            for (size_t i = 0; i < trailing_sz; ++i){
+                                (*op_buf++) = byte_array::read_byte(inp_buf, bit_offs);
+                                bit_offs += CHAR_BIT;
+                            }
+                            stats.delim(trailing_sz);
+                            stats.message(bit_offs - bit_first, std::distance(op_first, op_buf));
+                            return {bit_offs, op_buf};
+                        }
+
+                        std::memcpy(op_buf, leaf.c.data(), ALPHABET_SIZE);
+                        op_buf += ALPHABET_SIZE;
+                    } else{
+                        bad_bit     = false;
+                        auto tape   = byte_array::read(inp_buf, bit_offs++); 
+                        stats.fallback_bit();
+                        
+                        if (tape == constants::L){
+                            cursor = node[cursor].l;
+                        } else{
+                            cursor = node[cursor].r;
+                        }
+
+                        if (model::is_leaf(node[cursor])){
+                            if (node[cursor].delim_stat == model::ESCAPE_STAT){
+                                op_buf = this->expand_run(inp_buf, bit_offs, op_buf, stats);
+                                cursor = root;
+                                continue;
+                            }
+
+                            if (node[cursor].delim_stat){
+                                auto trailing_sz    = node[cursor].delim_stat -1;
+                                for (size_t i = 0; i < trailing_sz; ++i){
+                                    (*op_buf++) = byte_array::read_byte(inp_buf, bit_offs);
+                                    bit_offs += CHAR_BIT;
+                                }
+                                stats.delim(trailing_sz);
+                                stats.message(bit_offs - bit_first, std::distance(op_first, op_buf));
+                                return {bit_offs, op_buf};
+                            }
+                            std::memcpy(op_buf, node[cursor].c.data(), ALPHABET_SIZE);
+                            op_buf += ALPHABET_SIZE;
+                            cursor = root;
+                            stats.fallback_symbol();
+                        }
+                    }
+                } 
+            }
+
+            //same stream as fast_decode_into, but reads only [inp_buf, inp_buf + inp_sz) and writes only [op_buf, op_buf + op_cap)
+            //throws CorruptedError if the input ends before the delimiter and OutputOverflowError if op_cap is exceeded
+            //returns {one past the last input byte of the message, one past the last output byte}
+            auto checked_decode_into(const char * inp_buf, size_t inp_sz, char * op_buf, size_t op_cap) const -> std::pair<const char *, char *>{
+
+                auto stats = stats::NoStats{};
+                return this->checked_decode_into(inp_buf, inp_sz, op_buf, op_cap, stats);
+            }
+
+            template <class Stats>
+            auto checked_decode_into(const char * inp_buf, size_t inp_sz, char * op_buf, size_t op_cap, Stats& stats) const -> std::pair<const char *, char *>{
+
+                const auto& node    = this->delim_tree.node;
+                auto cursor         = this->delim_tree.root;
+                auto root           = this->delim_tree.root;
+                auto bit_offs       = size_t{0u};
+                auto bit_last       = inp_sz * CHAR_BIT;
+                auto op_last        = op_buf + op_cap;
+                auto op_first       = op_buf;
+                auto bad_bit        = bool{false};
+
+                auto delimit        = [&](size_t trailing_sz){
+                    if (bit_offs + trailing_sz * CHAR_BIT > bit_last){
+                        throw runtime_exception::CorruptedError{};
+                    }
+
+                    if (trailing_sz > static_cast<size_t>(std::distance(op_buf, op_last))){
+                        throw runtime_exception::OutputOverflowError{};
+                    }
+
+                    for (size_t i = 0; i < trailing_sz; ++i){
+                        (*op_buf++) = byte_array::read_byte(inp_buf, bit_offs);
+                        bit_offs += CHAR_BIT;
+                    }
+
+                    stats.delim(trailing_sz);
+                    stats.message(bit_offs, std::distance(op_first, op_buf));
+
+                    return std::make_pair(inp_buf + byte_array::byte_size(bit_offs), op_buf);
+                };
+
+                auto expand         = [&]{
+                    auto repeat_sz  = size_t{0u};
+                    auto shift      = size_t{0u};
+
+                    while (true){
+                        if (bit_offs + CHAR_BIT > bit_last || shift >= std::numeric_limits<size_t>::digits){
+                            throw runtime_exception::CorruptedError{};
+                        }
+
+                        auto byte   = static_cast<uint8_t>(byte_array::read_byte(inp_buf, bit_offs));
+                        bit_offs    += CHAR_BIT;
+                        repeat_sz   |= static_cast<size_t>(byte & 0x7Fu) << shift;
+                        shift       += 7;
+
+                        if ((byte & 0x80u) == 0u){
+                            break;
+                        }
+                    }
+
+                    if (static_cast<size_t>(std::distance(op_first, op_buf)) < ALPHABET_SIZE){
+                        throw runtime_exception::CorruptedError{};
+                    }
+
+                    if (repeat_sz > static_cast<size_t>(std::distance(op_buf, op_last)) / ALPHABET_SIZE){
+                        throw runtime_exception::OutputOverflowError{};
+                    }
+
+                    op_buf = fill_run(op_buf, repeat_sz);
+                    stats.run(repeat_sz);
+                };
+
+                while (true){
+                    auto room               = static_cast<size_t>(std::distance(op_buf, op_last));
+                    bool table_prereq       = (bit_offs + bit_stream::read_padd_requirement() < bit_last) && (cursor == root);
+                    bool dictionary_prereq  = table_prereq && (!bad_bit) && (room >= constants::DECODE_ENTRY_BYTE_CAP);
+                    bool canonical_prereq   = table_prereq && (this->canonical_table.max_length != 0u) && (room >= ALPHABET_SIZE);
+
+                    if (dictionary_prereq){
+                        auto tape           = bit_stream::read(inp_buf, bit_offs, std::integral_constant<size_t, constants::DECODE_TABLE_BIT_SIZE>{});
+                        const auto& entry   = this->decoding_dict[tape];
+                        std::memcpy(op_buf, entry.bytes.data(), entry.byte_sz);
+                        op_buf   += entry.byte_sz;
+                        bit_offs += entry.bit_sz;
+                        bad_bit  = entry.bit_sz == 0u;
+                        stats.table(entry.bit_sz, entry.byte_sz / ALPHABET_SIZE);
+                    } else if (canonical_prereq){
+                        bad_bit             = false;
+                        const auto& leaf    = this->canonical_read(inp_buf, bit_offs);
+                        stats.canonical(leaf.delim_stat != 0u);
+
+                        if (leaf.delim_stat == model::ESCAPE_STAT){
+                            expand();
+                            continue;
+                        }
+
+                        if (leaf.delim_stat){
+                            return delimit(leaf.delim_stat - 1);
+                        }
+
+                        std::memcpy(op_buf, leaf.c.data(), ALPHABET_SIZE);
+                        op_buf += ALPHABET_SIZE;
+                    } else{
+                        if (bit_offs == bit_last){
+                            throw runtime_exception::CorruptedError{};
+                        }
+
+                        bad_bit     = false;
+                        auto tape   = byte_array::read(inp_buf, bit_offs++); 
+                        stats.fallback_bit();
+                        
+                        if (tape == constants::L){
+                            cursor = node[cursor].l;
+                        } else{
+                            cursor = node[cursor].r;
+                        }
+
+                        if (model::is_leaf(node[cursor])){
+                            if (node[cursor].delim_stat == model::ESCAPE_STAT){
+                                expand();
+                                cursor = root;
+                                continue;
+                            }
+
+                            if (node[cursor].delim_stat){
+                                return delimit(node[cursor].delim_stat - 1);
+                            }
+
+                            if (room < ALPHABET_SIZE){
+                                throw runtime_exception::OutputOverflowError{};
+                            }
+
+                            std::memcpy(op_buf, node[cursor].c.data(), ALPHABET_SIZE);
+                            op_buf += ALPHABET_SIZE;
+                            cursor = root;
+                            stats.fallback_symbol();
+                        }
+                    }
+                } 
+            }
+
+            auto interleaved_encode_into(const char * inp_buf, size_t inp_sz, char * op_buf, size_t lane_sz = constants::INTERLEAVED_LANE_SZ) const noexcept -> char *{
+
+                if (lane_sz != 4u && lane_sz != 8u){
+                    std::abort();
+                }
+
+                auto seg_sz     = interleaved::segment_size<ALPHABET_SIZE>(inp_sz, lane_sz);
+                auto header     = op_buf;
+                auto lane_buf   = op_buf + interleaved::header_size(lane_sz);
+                header          = dg::compact_serializer::core::serialize(static_cast<uint8_t>(lane_sz), header);
+                header          = dg::compact_serializer::core::serialize(static_cast<uint64_t>(inp_sz), header);
+
+                for (size_t i = 0; i < lane_sz; ++i){
+                    auto lane_inp_sz    = (i + 1 == lane_sz) ? inp_sz - seg_sz * i : seg_sz;
+                    auto rdbuf          = bit_array_type{};
+                    auto last           = this->encode_into(inp_buf + seg_sz * i, lane_inp_sz, lane_buf, rdbuf);
+                    header              = dg::compact_serializer::core::serialize(static_cast<uint64_t>(std::distance(lane_buf, last)), header);
+                    lane_buf            = last;
+                }
+
+                return lane_buf;
+            }
+
+            auto interleaved_decode_into(const char * inp_buf, char * op_buf) const noexcept -> std::pair<const char *, char *>{
+
+                auto lane_sz    = uint8_t{};
+                auto inp_sz     = uint64_t{};
+                inp_buf         = dg::compact_serializer::core::deserialize(inp_buf, lane_sz);
+                inp_buf         = dg::compact_serializer::core::deserialize(inp_buf, inp_sz);
+
+                switch (lane_sz){
+                    case 4u:
+                        return this->interleaved_decode_into(inp_buf, inp_sz, op_buf, std::integral_constant<size_t, 4u>{});
+                    case 8u:
+                        return this->interleaved_decode_into(inp_buf, inp_sz, op_buf, std::integral_constant<size_t, 8u>{});
+                    default:
+                        std::abort();
+                }
+            }
+
+            auto decode_into(const char * inp_buf, size_t bit_offs, char * op_buf) const noexcept -> std::pair<size_t, char *>{
+
+                auto stats = stats::NoStats{};
+                return this->decode_into(inp_buf, bit_offs, op_buf, stats);
+            }
+
+            template <class Stats>
+            auto decode_into(const char * inp_buf, size_t bit_offs, char * op_buf, Stats& stats) const noexcept -> std::pair<size_t, char *>{
+
+                const auto& node    = this->delim_tree.node;
+                auto cursor         = this->delim_tree.root;
+                auto root           = this->delim_tree.root;
+                auto bit_first      = bit_offs;
+                auto op_first       = op_buf;
+                 
+                while (true){
+                    auto tape   = byte_array::read(inp_buf, bit_offs++); 
+                    stats.fallback_bit();
+                    
+                    if (tape == constants::L){
+                        cursor = node[cursor].l;
+                    } else{
+                        cursor = node[cursor].r;
+                    }
+
+                    if (model::is_leaf(node[cursor])){
+                        if (node[cursor].delim_stat == model::ESCAPE_STAT){
+                            op_buf = this->expand_run(inp_buf, bit_offs, op_buf, stats);
+                            cursor = root;
+                            continue;
+                        }
+
+                        if (node[cursor].delim_stat){
+                            auto trailing_sz    = node[cursor].delim_stat -1;
+                            for (size_t i = 0; i < trailing_sz; ++i){
+                                (*op_buf++) = byte_array::read_byte(inp_buf, bit_offs);
+                                bit_offs += CHAR_BIT;
+                            }
+                            stats.delim(trailing_sz);
+                            stats.message(bit_offs - bit_first, std::distance(op_first, op_buf));
+                            return {bit_offs, op_buf};
+                        }
+                        std::memcpy(op_buf, node[cursor].c.data(), ALPHABET_SIZE);
+                        op_buf += ALPHABET_SIZE;
+                        cursor = root;
+                        stats.fallback_symbol();
+                    }
+                } 
+            }
+        
+        private:
+
+            //fn gets whichever encoding dictionary the image carries, as a span
+            template <class Fn>
+            auto visit_encoding_dict(Fn&& fn) const noexcept{
+
+                return this->packed_encoding_dict.empty() ? fn(this->encoding_dict) : fn(this->packed_encoding_dict);
+            }
+
+            auto encoding(size_t num_rep) const noexcept -> bit_array_type{
+
+                return this->packed_encoding_dict.empty() ? this->encoding_dict[num_rep] : model::to_bit_array(this->packed_encoding_dict[num_rep]);
+            }
+
+            auto canonical_read(const char * inp_buf, size_t& bit_offs) const noexcept -> const model::DelimLeaf&{
+
+                auto tape   = bit_stream::read(inp_buf, bit_offs, std::integral_constant<size_t, constants::MAX_CODE_LENGTH>{});
+                auto code   = static_cast<uint64_t>(utility::reverse_bits(static_cast<uint32_t>(tape)));
+                auto len    = this->canonical_table.min_length;
+
+                while (len < this->canonical_table.max_length && code >= this->canonical_table.limit[len]){
+                    ++len;
+                }
+
+                bit_offs += len;
+                return this->canonical_table.leaf[this->canonical_table.offset[len] + (code >> (constants::MAX_CODE_LENGTH - len))];
+            }
+
+            //number of symbols right after the one just read that repeat it, at most cap
+            auto repeat_size(const char * inp_buf, size_t cap) const noexcept -> size_t{
+
+                auto prev = inp_buf - ALPHABET_SIZE;
+                auto rs   = size_t{0u};
+
+                while (rs < cap && std::memcmp(inp_buf + rs * ALPHABET_SIZE, prev, ALPHABET_SIZE) == 0){
+                    ++rs;
+                }
+
+                return rs;
+            }
+
+            static constexpr auto varint_size(size_t val) noexcept -> size_t{
+
+                auto rs = size_t{1u};
+
+                while (val >= 0x80u){
+                    val >>= 7;
+                    ++rs;
+                }
+
+                return rs;
+            }
+
+            auto run_bit_size(size_t repeat_sz) const noexcept -> size_t{
+
+                return bit_array::size(this->escape.front()) + varint_size(repeat_sz) * CHAR_BIT;
+            }
+
+            auto is_run(const bit_array_type& bit_rep, size_t repeat_sz) const noexcept -> bool{
+
+                return repeat_sz >= constants::RLE_MIN_REPEAT_SZ && this->run_bit_size(repeat_sz) < bit_array::size(bit_rep) * repeat_sz;
+            }
+
+            auto stream_run_to(char * op_buf, size_t repeat_sz, bit_array_type& rdbuf) const noexcept -> char *{
+
+                op_buf = bit_stream::stream_to(op_buf, this->escape.front(), rdbuf);
+
+                while (repeat_sz >= 0x80u){
+                    op_buf      = bit_stream::stream_to(op_buf, bit_array::to_bit_array(static_cast<char>(repeat_sz | 0x80u)), rdbuf);
+                    repeat_sz   >>= 7;
+                }
+
+                return bit_stream::stream_to(op_buf, bit_array::to_bit_array(static_cast<char>(repeat_sz)), rdbuf);
+            }
+
+            //repeats the ALPHABET_SIZE bytes before op_buf repeat_sz times
+            static auto fill_run(char * op_buf, size_t repeat_sz) noexcept -> char *{
+
+                auto first  = op_buf - ALPHABET_SIZE;
+                auto sz     = repeat_sz * ALPHABET_SIZE;
+
+                if (std::all_of(first, op_buf, [&](char c){return c == *first;})){
+                    std::memset(op_buf, *first, sz);
+                    return op_buf + sz;
+                }
+
+                for (size_t filled = ALPHABET_SIZE; filled < sz + ALPHABET_SIZE;){
+                    auto copy_sz = std::min(filled, sz + ALPHABET_SIZE - filled);
+                    std::memcpy(first + filled, first, copy_sz);
+                    filled += copy_sz;
+                }
+
+                return op_buf + sz;
+            }
+
+            template <class Stats>
+            auto expand_run(const char * inp_buf, size_t& bit_offs, char * op_buf, Stats& stats) const noexcept -> char *{
+
+                auto repeat_sz  = size_t{0u};
+                auto shift      = size_t{0u};
+
+                while (true){
+                    auto byte   = static_cast<uint8_t>(byte_array::read_byte(inp_buf, bit_offs));
+                    bit_offs    += CHAR_BIT;
+                    repeat_sz   |= static_cast<size_t>(byte & 0x7Fu) << shift;
+                    shift       += 7;
+
+                    if ((byte & 0x80u) == 0u){
+                        break;
+                    }
+                }
+
+                stats.run(repeat_sz);
+                return fill_run(op_buf, repeat_sz);
+            }
+
+            template <size_t LANE_SZ>
+            auto interleaved_decode_into(const char * inp_buf, size_t inp_sz, char * op_buf, const std::integral_constant<size_t, LANE_SZ>) const noexcept -> std::pair<const char *, char *>{
+
+                auto seg_sz         = interleaved::segment_size<ALPHABET_SIZE>(inp_sz, LANE_SZ);
+                auto data           = inp_buf + sizeof(uint64_t) * LANE_SZ;
+                auto lane_buf       = std::array<const char *, LANE_SZ>{};
+                auto lane_bit_offs  = std::array<size_t, LANE_SZ>{};
+                auto lane_bit_last  = std::array<size_t, LANE_SZ>{};
+                auto lane_op_buf    = std::array<char *, LANE_SZ>{};
+                auto is_stalled     = bool{false};
+
+                for (size_t i = 0; i < LANE_SZ; ++i){
+                    auto lane_byte_sz   = uint64_t{};
+                    inp_buf             = dg::compact_serializer::core::deserialize(inp_buf, lane_byte_sz);
+                    lane_buf[i]         = data;
+                    lane_bit_last[i]    = lane_byte_sz * CHAR_BIT;
+                    lane_op_buf[i]      = op_buf + seg_sz * i;
+                    data                += lane_byte_sz;
+                }
+
+                //lanes carry no dependency on each other - stepping them in lockstep lets the table lookups overlap
+                //a delimiter never starts within read_padd_requirement() bits of the lane end, so the lockstep loop only sees symbols and escapes
+                while (!is_stalled){
+                    for (size_t i = 0; i < LANE_SZ; ++i){
+                        is_stalled |= lane_bit_offs[i] + bit_stream::read_padd_requirement() >= lane_bit_last[i];
+                    }
+
+                    if (is_stalled){
+                        break;
+                    }
+
+                    for (size_t i = 0; i < LANE_SZ; ++i){
+                        auto tape           = bit_stream::read(lane_buf[i], lane_bit_offs[i], std::integral_constant<size_t, constants::DECODE_TABLE_BIT_SIZE>{});
+                        const auto& entry   = this->decoding_dict[tape];
+
+                        if (entry.bit_sz != 0u){
+                            std::memcpy(lane_op_buf[i], entry.bytes.data(), entry.byte_sz);
+                            lane_op_buf[i]      += entry.byte_sz;
+                            lane_bit_offs[i]    += entry.bit_sz;
+                        } else if (this->canonical_table.max_length != 0u){
+                            const auto& leaf    = this->canonical_read(lane_buf[i], lane_bit_offs[i]);
+
+                            if (leaf.delim_stat == model::ESCAPE_STAT){
+                                auto stats      = stats::NoStats{};
+                                lane_op_buf[i]  = this->expand_run(lane_buf[i], lane_bit_offs[i], lane_op_buf[i], stats);
+                                continue;
+                            }
+
+                            std::memcpy(lane_op_buf[i], leaf.c.data(), ALPHABET_SIZE);
+                            lane_op_buf[i]      += ALPHABET_SIZE;
+                        } else{
+                            is_stalled = true;
+                        }
+                    }
+                }
+
+                for (size_t i = 0; i < LANE_SZ; ++i){
+                    lane_op_buf[i] = this->fast_decode_into(lane_buf[i], lane_bit_offs[i], lane_bit_last[i], lane_op_buf[i]).second;
+                }
+
+                return {data, lane_op_buf.back()};
+            }
+    };
+
+    //encode half of a FastEngine, over an image::ENCODE_ROLE image - codes and delimiters only, no tree and no decode tables
+    template <size_t ALPHABET_SIZE>
+    class EncodeEngine{
+
+        private:
+
+            FastEngine<ALPHABET_SIZE> engine;
+
+        public:
+
+            //image must have passed image::verify with image::ENCODE_ROLE
+            EncodeEngine(std::shared_ptr<const void> storage, 
+                         const char * image): engine(std::move(storage), image){}
+
+            auto get_image() const noexcept -> std::pair<const char *, size_t>{
+
+                return this->engine.get_image();
+            }
+
+            auto has_escape() const noexcept -> bool{
+
+                return this->engine.has_escape();
+            }
+
+            auto noexhaust_encode_into(const char * inp_buf, size_t inp_sz, char * op_buf, bit_array_type& rdbuf) const noexcept -> char *{
+
+                return this->engine.noexhaust_encode_into(inp_buf, inp_sz, op_buf, rdbuf);
+            }
+
+            auto encode_into(const char * inp_buf, size_t inp_sz, char * op_buf, bit_array_type& rdbuf) const noexcept -> char *{
+
+                return this->engine.encode_into(inp_buf, inp_sz, op_buf, rdbuf);
+            }
+
+            auto encoded_bit_size(const char * inp_buf, size_t inp_sz) const noexcept -> size_t{
+
+                return this->engine.encoded_bit_size(inp_buf, inp_sz);
+            }
+
+            auto encoded_size(const char * inp_buf, size_t inp_sz) const noexcept -> size_t{
+
+                return this->engine.encoded_size(inp_buf, inp_sz);
+            }
+
+            auto encoded_bit_size_bound(const std::vector<size_t>& counter) const noexcept -> size_t{
+
+                return this->engine.encoded_bit_size_bound(counter);
+            }
+
+            auto encode(const char * inp_buf, size_t inp_sz) const -> std::pair<std::unique_ptr<char[]>, size_t>{
+
+                return this->engine.encode(inp_buf, inp_sz);
+            }
+
+            auto interleaved_encode_into(const char * inp_buf, size_t inp_sz, char * op_buf, size_t lane_sz = constants::INTERLEAVED_LANE_SZ) const noexcept -> char *{
+
+                return this->engine.interleaved_encode_into(inp_buf, inp_sz, op_buf, lane_sz);
+            }
+    };
+
+    //decode half of a FastEngine - spawning only keeps the model, the image::DECODE_ROLE image is built on the first decode
+    //(or prepare), once, by whichever thread gets there first; that call may throw std::bad_alloc
+    //the allocator must outlive the build
+    template <size_t ALPHABET_SIZE>
+    class DecodeEngine{
+
+        private:
+
+            mutable model::Tree huffman_tree;   //released once the image is built
+            bool rle_escape;
+            memory::ImageAllocator * allocator;
+            mutable std::once_flag build_flag;
+            mutable std::unique_ptr<FastEngine<ALPHABET_SIZE>> engine;
+
+        public:
+
+            DecodeEngine(model::Tree huffman_tree, 
+                         bool rle_escape, 
+                         memory::ImageAllocator& allocator): huffman_tree(std::move(huffman_tree)),
+                                                             rle_escape(rle_escape),
+                                                             allocator(&allocator),
+                                                             build_flag(),
+                                                             engine(){}
+
+            void prepare() const{
+
+                this->built();
+            }
+
+            auto get_image() const -> std::pair<const char *, size_t>{
+
+                return this->built().get_image();
+            }
+
+            auto fast_decode_into(const char * inp_buf, size_t bit_offs, size_t bit_last, char * op_buf) const -> std::pair<size_t, char *>{
+
+                return this->built().fast_decode_into(inp_buf, bit_offs, bit_last, op_buf);
+            }
+
+            template <class Stats>
+            auto fast_decode_into(const char * inp_buf, size_t bit_offs, size_t bit_last, char * op_buf, Stats& stats) const -> std::pair<size_t, char *>{
+
+                return this->built().fast_decode_into(inp_buf, bit_offs, bit_last, op_buf, stats);
+            }
+
+            auto checked_decode_into(const char * inp_buf, size_t inp_sz, char * op_buf, size_t op_cap) const -> std::pair<const char *, char *>{
+
+                return this->built().checked_decode_into(inp_buf, inp_sz, op_buf, op_cap);
+            }
+
+            template <class Stats>
+            auto checked_decode_into(const char * inp_buf, size_t inp_sz, char * op_buf, size_t op_cap, Stats& stats) const -> std::pair<const char *, char *>{
+
+                return this->built().checked_decode_into(inp_buf, inp_sz, op_buf, op_cap, stats);
+            }
+
+            auto decode_into(const char * inp_buf, size_t bit_offs, char * op_buf) const -> std::pair<size_t, char *>{
+
+                return this->built().decode_into(inp_buf, bit_offs, op_buf);
+            }
+
+            template <class Stats>
+            auto decode_into(const char * inp_buf, size_t bit_offs, char * op_buf, Stats& stats) const -> std::pair<size_t, char *>{
+
+                return this->built().decode_into(inp_buf, bit_offs, op_buf, stats);
+            }
+
+            auto interleaved_decode_into(const char * inp_buf, char * op_buf) const -> std::pair<const char *, char *>{
+
+                return this->built().interleaved_decode_into(inp_buf, op_buf);
+            }
+
+        private:
+
+            auto built() const -> const FastEngine<ALPHABET_SIZE>&{
+
+                std::call_once(this->build_flag, [this]{
+                    auto delim_tree     = make::to_delim_tree<ALPHABET_SIZE>(this->huffman_tree, this->rle_escape);
+                    auto [image, sz]    = make::to_image<ALPHABET_SIZE>(delim_tree, image::DECODE_ROLE, *this->allocator);
+                    auto image_ptr      = image.get();
+                    this->engine        = std::make_unique<FastEngine<ALPHABET_SIZE>>(std::move(image), image_ptr);
+                    this->huffman_tree  = model::Tree{};
+                });
+
+                return *this->engine;
+            }
+    };
+
+    //a row may mix symbol widths - each column is dispatched to its engine once per row
+    using AnyFastEngine = std::variant<std::unique_ptr<FastEngine<1u>>, std::unique_ptr<FastEngine<2u>>>;
+
+    class RowEncodingEngine{
+
+        private:
+
+            std::vector<AnyFastEngine> encoders;
+        
+        public:
+
+            RowEncodingEngine(std::vector<AnyFastEngine> encoders): encoders(std::move(encoders)){}
+
+            auto encode_into(const std::vector<std::pair<const char *, size_t>>& data, char * buf) const -> char *{
+
+                assert(data.size() == this->encoders.size()); 
+                auto rdbuf = types::bit_array_type{};
+
+                for (size_t i = 0; i < data.size(); ++i){
+                    buf = std::visit([&](const auto& encoder){return encoder->noexhaust_encode_into(data[i].first, data[i].second, buf, rdbuf);}, this->encoders[i]);
+                }
+
+                return bit_stream::exhaust_to(buf, rdbuf);
+            }
+
+            auto encoded_size(const std::vector<std::pair<const char *, size_t>>& data) const noexcept -> size_t{
+
+                assert(data.size() == this->encoders.size());
+                auto bit_sz = size_t{0u};
+
+                for (size_t i = 0; i < data.size(); ++i){
+                    bit_sz += std::visit([&](const auto& encoder){return encoder->encoded_bit_size(data[i].first, data[i].second);}, this->encoders[i]);
+                }
+
+                return byte_array::byte_size(bit_sz);
+            }
+
+            auto encode(const std::vector<std::pair<const char *, size_t>>& data) const -> std::pair<std::unique_ptr<char[]>, size_t>{
+
+                auto sz     = this->encoded_size(data);
+                auto buf    = std::unique_ptr<char[]>(new char[sz]);
+                this->encode_into(data, buf.get());
+
+                return {std::move(buf), sz};
+            }
+
+            auto decode_into(const char * buf, std::vector<std::pair<char *, size_t>>& data) const -> const char *{
+
+                assert(data.size() == this->encoders.size());
+                auto buf_bit_offs   = size_t{0u};
+                auto last           = std::add_pointer_t<char>();
+
+                for (size_t i = 0; i < this->encoders.size(); ++i){
+                    std::tie(buf_bit_offs, last) = std::visit([&](const auto& encoder){return encoder->decode_into(buf, buf_bit_offs, data[i].first);}, this->encoders[i]);
+                    data[i].second = std::distance(data[i].first, last); 
+                }
+
+                return buf + byte_array::byte_size(buf_bit_offs);
+            }
+    };
+}
+
+namespace dg::huffman_encoder::core{
+
+    //produces the same bitstream as FastEngine::encode_into over the concatenated input, one window at a time
+    //with an rle escape, a run of one symbol is held back until a different symbol or finish closes it
+    template <size_t ALPHABET_SIZE>
+    class StreamEncoder{
+
+        private:
+
+            static inline constexpr size_t STAGING_SZ   = sizeof(bit_container_type) * 2; //delim + trailing bytes never exceed one word, exhausting adds another
+            static inline constexpr size_t PENDING_SZ   = 2 + (std::numeric_limits<size_t>::digits + 6) / 7; //symbol, escape, LEB128 repeat count
+
+            const FastEngine<ALPHABET_SIZE> * engine;
+            bit_array_type rdbuf;
+            word_type carry;
+            size_t carry_sz;
+            std::array<char, STAGING_SZ> staging;
+            size_t staging_first;
+            size_t staging_last;
+            size_t run_num_rep;
+            size_t run_sz;              //repeats of run_num_rep after its first occurrence
+            bool is_run_open;
+            std::array<bit_array_type, PENDING_SZ> pending; //codes of the last closed run, in stream order
+            size_t pending_first;
+            size_t pending_last;
+            bit_array_type repeat_code;
+            size_t repeat_sz;           //copies of repeat_code still owed after pending
+            bool is_finished;
+
+        public:
+
+            //engine must outlive the encoder
+            StreamEncoder(const FastEngine<ALPHABET_SIZE> * engine): engine(engine),
+                                                      rdbuf(),
+                                                      carry(),
+                                                      carry_sz(0u),
+                                                      staging(),
+                                                      staging_first(0u),
+                                                      staging_last(0u),
+                                                      run_num_rep(0u),
+                                                      run_sz(0u),
+                                                      is_run_open(false),
+                                                      pending(),
+                                                      pending_first(0u),
+                                                      pending_last(0u),
+                                                      repeat_code(),
+                                                      repeat_sz(0u),
+                                                      is_finished(false){}
+
+            //encodes as much of inp_buf as the op_buf window allows - returns {consumed, produced}
+            //an odd trailing byte is carried over to the next call
+            auto encode(const char * inp_buf, size_t inp_sz, char * op_buf, size_t op_sz) noexcept -> std::pair<size_t, size_t>{
+
+                assert(!this->is_finished);
+
+                auto ibuf   = inp_buf;
+                auto ilast  = inp_buf + inp_sz;
+                auto obuf   = this->drain(op_buf, op_buf + op_sz);
+                auto olast  = op_buf + op_sz;
+                auto is_rle = this->engine->has_escape();
+
+                //whole symbols while a word fits, with the stream buffer in a register - the loop below handles the rest
+                if (!is_rle && this->carry_sz == 0u && this->staging_first == this->staging_last){
+                    auto rdbuf = this->rdbuf;
+
+                    while (static_cast<size_t>(std::distance(ibuf, ilast)) >= ALPHABET_SIZE && static_cast<size_t>(std::distance(obuf, olast)) >= sizeof(bit_container_type)){
+                        auto num_rep    = num_rep_type<ALPHABET_SIZE>{};
+                        ibuf            = dg::compact_serializer::core::deserialize(ibuf, num_rep);
+                        obuf            = bit_stream::stream_to(obuf, this->engine->encoding(num_rep), rdbuf);
+                    }
+
+                    this->rdbuf = rdbuf;
+                }
+
+                while (this->staging_first == this->staging_last){
+                    if (is_rle && this->has_pending()){
+                        obuf = this->put(this->next_pending(), obuf, olast);
+                        continue;
+                    }
+
+                    auto num_rep = num_rep_type<ALPHABET_SIZE>{};
+
+                    if (this->carry_sz != 0u){
+                        auto fill_sz = std::min(ALPHABET_SIZE - this->carry_sz, static_cast<size_t>(std::distance(ibuf, ilast)));
+                        std::memcpy(this->carry.data() + this->carry_sz, ibuf, fill_sz);
+                        this->carry_sz  += fill_sz;
+                        ibuf            += fill_sz;
+
+                        if (this->carry_sz != ALPHABET_SIZE){
+                            break;
+                        }
+
+                        dg::compact_serializer::core::deserialize(this->carry.data(), num_rep);
+                        this->carry_sz = 0u;
+                    } else if (static_cast<size_t>(std::distance(ibuf, ilast)) >= ALPHABET_SIZE){
+                        ibuf = dg::compact_serializer::core::deserialize(ibuf, num_rep);
+                    } else{
+                        this->carry_sz  = std::distance(ibuf, ilast);
+                        std::memcpy(this->carry.data(), ibuf, this->carry_sz);
+                        ibuf            = ilast;
+                        break;
+                    }
+
+                    if (is_rle){
+                        if (this->is_run_open && num_rep == this->run_num_rep){
+                            ++this->run_sz;
+                            continue;
+                        }
+
+                        if (this->is_run_open){
+                            this->close_run();
+                        }
+
+                        this->run_num_rep   = num_rep;
+                        this->run_sz        = 0u;
+                        this->is_run_open   = true;
+                        continue;
+                    }
+
+                    const auto bit_rep = this->engine->encoding(num_rep);
+
+                    if (static_cast<size_t>(std::distance(obuf, olast)) >= sizeof(bit_container_type)){
+                        obuf = bit_stream::stream_to(obuf, bit_rep, this->rdbuf);
+                    } else{
+                        obuf = this->stage(bit_rep, obuf, olast);
+                    }
+                }
+
+                return {std::distance(inp_buf, ibuf), std::distance(op_buf, obuf)};
+            }
+
+            //flushes the open run, the delimiter, the carried byte and the partial word - call until it reports done
+            //returns {produced, is_done}
+            auto finish(char * op_buf, size_t op_sz) noexcept -> std::pair<size_t, bool>{
+
+                auto obuf   = this->drain(op_buf, op_buf + op_sz);
+                auto olast  = op_buf + op_sz;
+
+                while (!this->is_finished && this->staging_first == this->staging_last){
+                    if (this->has_pending()){
+                        obuf = this->put(this->next_pending(), obuf, olast);
+                        continue;
+                    }
+
+                    if (this->is_run_open){
+                        this->close_run();
+                        continue;
+                    }
+
+                    auto last   = bit_stream::stream_to(this->staging.data(), this->engine->delim[this->carry_sz], this->rdbuf);
+
+                    for (size_t i = 0; i < this->carry_sz; ++i){
+                        last = bit_stream::stream_to(last, bit_array::to_bit_array(this->carry[i]), this->rdbuf);
+                    }
+
+                    this->staging_first = 0u;
+                    this->staging_last  = std::distance(this->staging.data(), bit_stream::exhaust_to(last, this->rdbuf));
+                    this->carry_sz      = 0u;
+                    this->is_finished   = true;
+                    obuf                = this->drain(obuf, olast);
+                }
+
+                return {std::distance(op_buf, obuf), this->is_finished && this->staging_first == this->staging_last};
+            }
+
+            //starts a new message - pending state is discarded
+            void reset() noexcept{
+
+                this->rdbuf         = bit_array_type{};
+                this->carry_sz      = 0u;
+                this->staging_first = 0u;
+                this->staging_last  = 0u;
+                this->is_run_open   = false;
+                this->pending_first = 0u;
+                this->pending_last  = 0u;
+                this->repeat_sz     = 0u;
+                this->is_finished   = false;
+            }
+
+        private:
+
+            //streams one code straight into the window while a word fits, through staging otherwise
+            auto put(const bit_array_type& bit_rep, char * op_buf, char * op_last) noexcept -> char *{
+
+                if (static_cast<size_t>(std::distance(op_buf, op_last)) >= sizeof(bit_container_type)){
+                    return bit_stream::stream_to(op_buf, bit_rep, this->rdbuf);
+                }
+
+                return this->stage(bit_rep, op_buf, op_last);
+            }
+
+            auto stage(const bit_array_type& bit_rep, char * op_buf, char * op_last) noexcept -> char *{
+
+                this->staging_first = 0u;
+                this->staging_last  = std::distance(this->staging.data(), bit_stream::stream_to(this->staging.data(), bit_rep, this->rdbuf));
+
+                return this->drain(op_buf, op_last);
+            }
+
+            //queues the codes FastEngine::encode_into emits for the open run - its symbol, then the rle escape or the plain repeats
+            void close_run() noexcept{
+
+                auto bit_rep        = this->engine->encoding(this->run_num_rep);
+                this->pending_first = 0u;
+                this->pending_last  = 0u;
+                this->is_run_open   = false;
+                this->pending[this->pending_last++] = bit_rep;
+
+                if (!this->engine->is_run(bit_rep, this->run_sz)){
+                    this->repeat_code   = bit_rep;
+                    this->repeat_sz     = this->run_sz;
+                    return;
+                }
+
+                auto repeat_sz = this->run_sz;
+                this->pending[this->pending_last++] = this->engine->escape.front();
+
+                while (repeat_sz >= 0x80u){
+                    this->pending[this->pending_last++] = bit_array::to_bit_array(static_cast<char>(repeat_sz | 0x80u));
+                    repeat_sz >>= 7;
+                }
+
+                this->pending[this->pending_last++] = bit_array::to_bit_array(static_cast<char>(repeat_sz));
+            }
+
+            auto has_pending() const noexcept -> bool{
+
+                return this->pending_first != this->pending_last || this->repeat_sz != 0u;
+            }
+
+            //has_pending() must hold
+            auto next_pending() noexcept -> bit_array_type{
+
+                if (this->pending_first != this->pending_last){
+                    return this->pending[this->pending_first++];
+                }
+
+                --this->repeat_sz;
+                return this->repeat_code;
+            }
+
+            auto drain(char * op_buf, char * op_last) noexcept -> char *{
+
+                auto sz = std::min(this->staging_last - this->staging_first, static_cast<size_t>(std::distance(op_buf, op_last)));
+                std::memcpy(op_buf, this->staging.data() + this->staging_first, sz);
+                this->staging_first += sz;
+
+                return op_buf + sz;
+            }
+    };
+
+    //decodes one FastEngine::encode_into message that arrives in arbitrary chunks, one output window at a time
+    //the table paths run until read_padd_requirement() bits before the end of each chunk, the tree walk covers the rest
+    //an rle run is expanded across as many output windows as it needs
+    template <size_t ALPHABET_SIZE>
+    class StreamDecoder{
+
+        private:
+
+            const FastEngine<ALPHABET_SIZE> * engine;
+            uint32_t cursor;
+            size_t bit_offs;            //into the first byte of the next chunk - the caller resupplies a partially consumed byte
+            size_t trailing_sz;         //raw bytes still expected after the delimiter
+            size_t trailing_bit_sz;
+            unsigned char trailing_byte;
+            bool is_delimited;
+            bool is_run_count;          //reading the LEB128 repeat count after an rle escape - bytewise, like trailing bytes
+            size_t run_shift;
+            size_t run_sz;              //symbols of the current run still to emit
+            word_type tail;             //last symbol handed out - the one a run repeats
+            bool is_finished;
+            word_type staging;
+            size_t staging_first;
+            size_t staging_last;
+
+        public:
+
+            //engine must outlive the decoder
+            StreamDecoder(const FastEngine<ALPHABET_SIZE> * engine): engine(engine),
+                                                      cursor(engine->delim_tree.root),
+                                                      bit_offs(0u),
+                                                      trailing_sz(0u),
+                                                      trailing_bit_sz(0u),
+                                                      trailing_byte(0u),
+                                                      is_delimited(false),
+                                                      is_run_count(false),
+                                                      run_shift(0u),
+                                                      run_sz(0u),
+                                                      tail(),
+                                                      is_finished(false),
+                                                      staging(),
+                                                      staging_first(0u),
+                                                      staging_last(0u){}
+
+            //returns {consumed, produced} - consumption stops at the end of the message, which includes its padding bits
+            auto decode(const char * inp_buf, size_t inp_sz, char * op_buf, size_t op_sz) noexcept -> std::pair<size_t, size_t>{
+
+                const auto& node    = this->engine->delim_tree.node;
+                auto root           = this->engine->delim_tree.root;
+                auto bit_offs       = this->bit_offs;
+                auto bit_last       = inp_sz * CHAR_BIT;
+                auto olast          = op_buf + op_sz;
+                auto obuf           = this->drain(op_buf, olast);
+                auto ofirst         = obuf; //output of this call not yet folded into tail
+                auto is_looped      = false;
+                auto bad_bit        = bool{false};
+
+                while (!this->is_finished && this->staging_first == this->staging_last && (bit_offs < bit_last || this->run_sz != 0u)){
+                    auto room = static_cast<size_t>(std::distance(obuf, olast));
+                    is_looped = true;
+
+                    if (this->run_sz != 0u){
+                        if (room == 0u){
+                            break;
+                        }
+
+                        auto fill_sz = std::min(this->run_sz, room / ALPHABET_SIZE);
+
+                        if (fill_sz == 0u){
+                            obuf = this->emit(this->tail.data(), ALPHABET_SIZE, obuf, olast);
+                            --this->run_sz;
+                            continue;
+                        }
+
+                        std::memcpy(obuf, this->tail.data(), ALPHABET_SIZE);
+                        obuf            = FastEngine<ALPHABET_SIZE>::fill_run(obuf + ALPHABET_SIZE, fill_sz - 1u);
+                        this->run_sz    -= fill_sz;
+                        continue;
+                    }
+
+                    if (this->is_run_count){
+                        this->trailing_byte |= static_cast<unsigned char>(byte_array::read(inp_buf, bit_offs++)) << (this->trailing_bit_sz++);
+
+                        if (this->trailing_bit_sz == CHAR_BIT){
+                            if (this->run_shift < std::numeric_limits<size_t>::digits){
+                                this->run_sz |= static_cast<size_t>(this->trailing_byte & 0x7Fu) << this->run_shift;
+                            }
+
+                            this->run_shift         += 7;
+                            this->is_run_count      = (this->trailing_byte & 0x80u) != 0u;
+                            this->trailing_byte     = 0u;
+                            this->trailing_bit_sz   = 0u;
+                        }
+
+                        continue;
+                    }
+
+                    if (this->is_delimited){
+                        this->trailing_byte |= static_cast<unsigned char>(byte_array::read(inp_buf, bit_offs++)) << (this->trailing_bit_sz++);
+
+                        if (this->trailing_bit_sz == CHAR_BIT){
+                            auto c                  = static_cast<char>(this->trailing_byte);
+                            obuf                    = this->emit(&c, 1u, obuf, olast);
+                            this->trailing_byte     = 0u;
+                            this->trailing_bit_sz   = 0u;
+                            this->is_finished       = --this->trailing_sz == 0u;
+                        }
+
+                        continue;
+                    }
+
+                    bool table_prereq       = (bit_offs + bit_stream::read_padd_requirement() < bit_last) && (this->cursor == root);
+                    bool dictionary_prereq  = table_prereq && (!bad_bit) && (room >= constants::DECODE_ENTRY_BYTE_CAP);
+                    bool canonical_prereq   = table_prereq && (this->engine->canonical_table.max_length != 0u) && (room >= ALPHABET_SIZE);
+
+                    if (dictionary_prereq){
+                        auto tape           = bit_stream::read(inp_buf, bit_offs, std::integral_constant<size_t, constants::DECODE_TABLE_BIT_SIZE>{});
+                        const auto& entry   = this->engine->decoding_dict[tape];
+                        std::memcpy(obuf, entry.bytes.data(), entry.byte_sz);
+                        obuf     += entry.byte_sz;
+                        bit_offs += entry.bit_sz;
+                        bad_bit  = entry.bit_sz == 0u;
+                    } else if (canonical_prereq){
+                        bad_bit             = false;
+                        const auto& leaf    = this->engine->canonical_read(inp_buf, bit_offs);
+
+                        if (leaf.delim_stat == model::ESCAPE_STAT){
+                            this->fold_tail(ofirst, obuf);
+                            ofirst = obuf;
+                            this->start_run();
+                        } else if (leaf.delim_stat){
+                            this->delimit(leaf.delim_stat - 1);
+                        } else{
+                            std::memcpy(obuf, leaf.c.data(), ALPHABET_SIZE);
+                            obuf += ALPHABET_SIZE;
+                        }
+                    } else{
+                        bad_bit     = false;
+                        auto tape   = byte_array::read(inp_buf, bit_offs++);
+
+                        if (tape == constants::L){
+                            this->cursor = node[this->cursor].l;
+                        } else{
+                            this->cursor = node[this->cursor].r;
+                        }
+
+                        if (model::is_leaf(node[this->cursor])){
+                            if (node[this->cursor].delim_stat == model::ESCAPE_STAT){
+                                this->fold_tail(ofirst, obuf);
+                                ofirst = obuf;
+                                this->start_run();
+                            } else if (node[this->cursor].delim_stat){
+                                this->delimit(node[this->cursor].delim_stat - 1);
+                            } else{
+                                obuf = this->emit(node[this->cursor].c.data(), ALPHABET_SIZE, obuf, olast);
+                            }
+
+                            this->cursor = root;
+                        }
+                    }
+                }
+
+                //the loop starts with staging drained, so anything staged now is the rest of this call's last emit
+                this->fold_tail(ofirst, obuf);
+
+                if (is_looped){
+                    this->fold_tail(this->staging.data() + this->staging_first, this->staging.data() + this->staging_last);
+                }
+
+                if (this->is_finished){
+                    bit_offs = byte_array::byte_size(bit_offs) * CHAR_BIT;
+                }
+
+                this->bit_offs = byte_array::offs(bit_offs);
+                return {byte_array::slot(bit_offs), std::distance(op_buf, obuf)};
+            }
+
+            //true once the delimiter, its trailing bytes and all staged output have been handed out
+            auto is_done() const noexcept -> bool{
+
+                return this->is_finished && this->staging_first == this->staging_last;
+            }
+
+            void reset() noexcept{
+
+                this->cursor            = this->engine->delim_tree.root;
+                this->bit_offs          = 0u;
+                this->trailing_sz       = 0u;
+                this->trailing_bit_sz   = 0u;
+                this->trailing_byte     = 0u;
+                this->is_delimited      = false;
+                this->is_run_count      = false;
+                this->run_shift         = 0u;
+                this->run_sz            = 0u;
+                this->tail              = word_type{};
+                this->is_finished       = false;
+                this->staging_first     = 0u;
+                this->staging_last      = 0u;
+            }
+
+        private:
+
+            void start_run() noexcept{
+
+                this->is_run_count  = true;
+                this->run_shift     = 0u;
+                this->run_sz        = 0u;
+            }
+
+            //shifts [first, last) into tail, which then holds the last ALPHABET_SIZE bytes handed out
+            void fold_tail(const char * first, const char * last) noexcept{
+
+                auto sz = std::min(static_cast<size_t>(std::distance(first, last)), ALPHABET_SIZE);
+                std::memmove(this->tail.data(), this->tail.data() + sz, ALPHABET_SIZE - sz);
+                std::memcpy(this->tail.data() + ALPHABET_SIZE - sz, last - sz, sz);
+            }
+
+            void delimit(size_t trailing_sz) noexcept{
+
+                this->trailing_sz   = trailing_sz;
+                this->is_delimited  = true;
+                this->is_finished   = trailing_sz == 0u;
+            }
+
+            auto emit(const char * data, size_t sz, char * op_buf, char * op_last) noexcept -> char *{
+
+                auto direct_sz = std::min(sz, static_cast<size_t>(std::distance(op_buf, op_last)));
+                std::memcpy(op_buf, data, direct_sz);
+                std::memcpy(this->staging.data(), data + direct_sz, sz - direct_sz);
+                this->staging_first = 0u;
+                this->staging_last  = sz - direct_sz;
+
+                return op_buf + direct_sz;
+            }
+
+            auto drain(char * op_buf, char * op_last) noexcept -> char *{
+
+                auto sz = std::min(this->staging_last - this->staging_first, static_cast<size_t>(std::distance(op_buf, op_last)));
+                std::memcpy(op_buf, this->staging.data() + this->staging_first, sz);
+                this->staging_first += sz;
+
+                return op_buf + sz;
+            }
+    };
+}
+
+namespace dg::huffman_encoder::core{
+
+    template <size_t ALPHABET_SIZE>
+    class FrameEngine{
+
+        private:
+
+            std::unique_ptr<FastEngine<ALPHABET_SIZE>> engine;
+            std::unique_ptr<dg::thread_pool::WorkStealingPool> pool;
+            size_t block_sz;
+
+        public:
+
+            FrameEngine(std::unique_ptr<FastEngine<ALPHABET_SIZE>> engine, 
+                        std::unique_ptr<dg::thread_pool::WorkStealingPool> pool,
+                        size_t block_sz): engine(std::move(engine)),
+                                          pool(std::move(pool)),
+                                          block_sz(block_sz){}
+
+            //block sizes are computed in a first pass so every block is encoded straight into its final position
+            auto encode_into(const char * inp_buf, size_t inp_sz, char * op_buf) const -> char *{
+
+                auto blk_count  = frame::block_count(inp_sz, this->block_sz);
+                auto blk_bytes  = std::vector<size_t>(blk_count);
+                auto blk_offs   = std::vector<size_t>(blk_count);
+                auto blk_inp_sz = [&](size_t idx){return std::min(this->block_sz, inp_sz - idx * this->block_sz);};
+
+                this->pool->parallel_for(blk_count, [&](size_t idx){
+                    blk_bytes[idx] = std::min(byte_array::byte_size(this->engine->encoded_bit_size(inp_buf + idx * this->block_sz, blk_inp_sz(idx))), blk_inp_sz(idx));
+                });
+
+                std::exclusive_scan(blk_bytes.begin(), blk_bytes.end(), blk_offs.begin(), frame::header_size(blk_count));
+                auto header = op_buf;
+                header      = dg::compact_serializer::core::serialize(static_cast<uint64_t>(inp_sz), header);
+                header      = dg::compact_serializer::core::serialize(static_cast<uint64_t>(this->block_sz), header);
+
+                for (size_t i = 0; i < blk_count; ++i){
+                    header  = dg::compact_serializer::core::serialize(static_cast<uint64_t>(blk_bytes[i]), header);
+                }
+
+                this->pool->parallel_for(blk_count, [&](size_t idx){
+                    if (blk_bytes[idx] == blk_inp_sz(idx)){
+                        std::memcpy(op_buf + blk_offs[idx], inp_buf + idx * this->block_sz, blk_bytes[idx]);
+                        return;
+                    }
+
+                    auto rdbuf = bit_array_type{};
+                    this->engine->encode_into(inp_buf + idx * this->block_sz, blk_inp_sz(idx), op_buf + blk_offs[idx], rdbuf);
+                });
+
+                if (blk_count == 0u){
+                    return header;
+                }
+
+                return op_buf + blk_offs.back() + blk_bytes.back();
+            }
+
+            static auto decoded_size(const char * inp_buf) -> size_t{
+
+                auto inp_sz = uint64_t{};
+                dg::compact_serializer::core::deserialize(inp_buf, inp_sz);
+
+                return inp_sz;
+            }
+
+            auto decode_into(const char * inp_buf, char * op_buf) const -> std::pair<const char *, char *>{
+
+                auto stats = stats::NoStats{};
+                return this->decode_into(inp_buf, op_buf, stats);
+            }
+
+            //blocks count into their own sink and are merged into stats once the pool is done
+            template <class Stats>
+            auto decode_into(const char * inp_buf, char * op_buf, Stats& stats) const -> std::pair<const char *, char *>{
+
+                auto inp_sz     = uint64_t{};
+                auto blk_sz     = uint64_t{};
+                inp_buf         = dg::compact_serializer::core::deserialize(inp_buf, inp_sz);
+                inp_buf         = dg::compact_serializer::core::deserialize(inp_buf, blk_sz);
+                auto blk_count  = frame::block_count(inp_sz, blk_sz);
+                auto blk_bytes  = std::vector<size_t>(blk_count);
+                auto blk_offs   = std::vector<size_t>(blk_count);
+                auto blk_stats  = std::vector<Stats>(blk_count);
+
+                for (size_t i = 0; i < blk_count; ++i){
+                    auto bytes  = uint64_t{};
+                    inp_buf     = dg::compact_serializer::core::deserialize(inp_buf, bytes);
+                    blk_bytes[i] = bytes;
+                }
+
+                std::exclusive_scan(blk_bytes.begin(), blk_bytes.end(), blk_offs.begin(), size_t{0u});
+
+                this->pool->parallel_for(blk_count, [&](size_t idx){
+                    auto blk_op_sz = std::min(static_cast<size_t>(blk_sz), static_cast<size_t>(inp_sz - idx * blk_sz));
+
+                    if (blk_bytes[idx] == blk_op_sz){
+                        std::memcpy(op_buf + idx * blk_sz, inp_buf + blk_offs[idx], blk_op_sz);
+                        blk_stats[idx].stored(blk_op_sz);
+                        return;
+                    }
+
+                    this->engine->fast_decode_into(inp_buf + blk_offs[idx], 0u, blk_bytes[idx] * CHAR_BIT, op_buf + idx * blk_sz, blk_stats[idx]);
+                });
+
+                for (const auto& blk_stat: blk_stats){
+                    stats += blk_stat;
+                }
+
+                if (blk_count == 0u){
+                    return {inp_buf, op_buf};
+                }
+
+                return {inp_buf + blk_offs.back() + blk_bytes.back(), op_buf + inp_sz};
+            }
+
+            //decode_into over an untrusted frame - see FastEngine::checked_decode_into
+            auto checked_decode_into(const char * inp_buf, size_t inp_sz, char * op_buf, size_t op_cap) const -> std::pair<const char *, char *>{
+
+                auto stats = stats::NoStats{};
+                return this->checked_decode_into(inp_buf, inp_sz, op_buf, op_cap, stats);
+            }
+
+            template <class Stats>
+            auto checked_decode_into(const char * inp_buf, size_t inp_sz, char * op_buf, size_t op_cap, Stats& stats) const -> std::pair<const char *, char *>{
+
+                constexpr auto PREFIX_SZ    = sizeof(uint64_t) * 2;
+                auto inp_last               = inp_buf + inp_sz;
+                auto dec_sz                 = uint64_t{};
+                auto blk_sz                 = uint64_t{};
+
+                if (inp_sz < PREFIX_SZ){
+                    throw runtime_exception::CorruptedError{};
+                }
+
+                inp_buf = dg::compact_serializer::core::deserialize(inp_buf, dec_sz);
+                inp_buf = dg::compact_serializer::core::deserialize(inp_buf, blk_sz);
+
+                if (dec_sz != 0u && blk_sz == 0u){
+                    throw runtime_exception::CorruptedError{};
+                }
+
+                if (dec_sz > op_cap){
+                    throw runtime_exception::OutputOverflowError{};
+                }
+
+                auto blk_count = (dec_sz == 0u) ? size_t{0u} : static_cast<size_t>(dec_sz / blk_sz + (dec_sz % blk_sz != 0u));
+
+                if (blk_count > static_cast<size_t>(std::distance(inp_buf, inp_last)) / sizeof(uint64_t)){
+                    throw runtime_exception::CorruptedError{};
+                }
+
+                auto blk_bytes  = std::vector<size_t>(blk_count);
+                auto blk_offs   = std::vector<size_t>(blk_count);
+                auto blk_err    = std::vector<std::exception_ptr>(blk_count);
+                auto blk_stats  = std::vector<Stats>(blk_count);
+                auto data_sz    = static_cast<size_t>(std::distance(inp_buf, inp_last)) - blk_count * sizeof(uint64_t);
+                auto total_sz   = size_t{0u};
+
+                for (size_t i = 0; i < blk_count; ++i){
+                    auto bytes      = uint64_t{};
+                    inp_buf         = dg::compact_serializer::core::deserialize(inp_buf, bytes);
+
+                    if (bytes > data_sz - total_sz){
+                        throw runtime_exception::CorruptedError{};
+                    }
+
+                    blk_bytes[i]    = bytes;
+                    total_sz        += bytes;
+                }
+
+                std::exclusive_scan(blk_bytes.begin(), blk_bytes.end(), blk_offs.begin(), size_t{0u});
+
+                this->pool->parallel_for(blk_count, [&](size_t idx){
+                    auto blk_op_sz = std::min(static_cast<size_t>(blk_sz), static_cast<size_t>(dec_sz - idx * blk_sz));
+
+                    if (blk_bytes[idx] == blk_op_sz){
+                        std::memcpy(op_buf + idx * blk_sz, inp_buf + blk_offs[idx], blk_op_sz);
+                        blk_stats[idx].stored(blk_op_sz);
+                        return;
+                    }
+
+                    try{
+                        auto [_, last] = this->engine->checked_decode_into(inp_buf + blk_offs[idx], blk_bytes[idx], op_buf + idx * blk_sz, blk_op_sz, blk_stats[idx]);
+
+                        if (static_cast<size_t>(std::distance(op_buf + idx * blk_sz, last)) != blk_op_sz){
+                            throw runtime_exception::CorruptedError{};
+                        }
+                    } catch (...){
+                        blk_err[idx] = std::current_exception();
+                    }
+                });
+
+                for (const auto& err: blk_err){
+                    if (err){
+                        std::rethrow_exception(err);
+                    }
+                }
+
+                for (const auto& blk_stat: blk_stats){
+                    stats += blk_stat;
+                }
+
+                return {inp_buf + total_sz, op_buf + dec_sz};
+            }
+    };
+}
+
+namespace dg::huffman_encoder::core{
+
+    //FrameEngine that picks the symbol width per block - 8-bit tables stay in L1, 16-bit codes win on correlated byte pairs
+    class AdaptiveFrameEngine{
+
+        private:
+
+            std::unique_ptr<FastEngine<1u>> narrow_engine;
+            std::unique_ptr<FastEngine<2u>> wide_engine;
+            std::unique_ptr<dg::thread_pool::WorkStealingPool> pool;
+            size_t block_sz;
+            size_t wide_min_gain;
+
+        public:
+
+            AdaptiveFrameEngine(std::unique_ptr<FastEngine<1u>> narrow_engine,
+                                std::unique_ptr<FastEngine<2u>> wide_engine,
+                                std::unique_ptr<dg::thread_pool::WorkStealingPool> pool,
+                                size_t block_sz,
+                                size_t wide_min_gain): narrow_engine(std::move(narrow_engine)),
+                                                       wide_engine(std::move(wide_engine)),
+                                                       pool(std::move(pool)),
+                                                       block_sz(block_sz),
+                                                       wide_min_gain(wide_min_gain){}
+
+            //both costs come from one 16-bit histogram - the 8-bit one is its byte marginal
+            //frame::STORED_WIDTH if neither bound beats the raw size, so incompressible blocks skip the exact sizing pass
+            auto choose_width(const char * inp_buf, size_t inp_sz) const -> size_t{
+
+                auto wide_counter   = make::count<2u>(inp_buf, inp_sz);
+                auto narrow_counter = std::vector<size_t>(constants::DICT_SIZE<1u>, size_t{0u});
+
+                for (size_t i = 0; i < wide_counter.size(); ++i){
+                    narrow_counter[i & 0xFFu]   += wide_counter[i];
+                    narrow_counter[i >> 8]      += wide_counter[i];
+                }
+
+                if (inp_sz % 2u != 0u){
+                    narrow_counter[static_cast<uint8_t>(inp_buf[inp_sz - 1])] += 1u; //the wide histogram leaves the odd byte out, the narrow bound must not
+                }
+
+                auto narrow_bit_sz  = this->narrow_engine->encoded_bit_size_bound(narrow_counter);
+                auto wide_bit_sz    = this->wide_engine->encoded_bit_size_bound(wide_counter);
+
+                auto raw_bit_sz     = inp_sz * CHAR_BIT;
+
+                if (std::min(narrow_bit_sz, wide_bit_sz) >= raw_bit_sz){
+                    return frame::STORED_WIDTH;
+                }
+
+                if (narrow_bit_sz >= raw_bit_sz || wide_bit_sz * 100u < narrow_bit_sz * (100u - this->wide_min_gain)){
+                    return 2u;
+                }
+
+                return 1u;
+            }
+
+            auto encode_into(const char * inp_buf, size_t inp_sz, char * op_buf) const -> char *{
+
+                auto blk_count  = frame::block_count(inp_sz, this->block_sz);
+                auto blk_bytes  = std::vector<size_t>(blk_count);
+                auto blk_offs   = std::vector<size_t>(blk_count);
+                auto blk_width  = std::vector<uint8_t>(blk_count);
+                auto blk_inp_sz = [&](size_t idx){return std::min(this->block_sz, inp_sz - idx * this->block_sz);};
+
+                this->pool->parallel_for(blk_count, [&](size_t idx){
+                    auto blk_buf    = inp_buf + idx * this->block_sz;
+                    blk_width[idx]  = static_cast<uint8_t>(this->choose_width(blk_buf, blk_inp_sz(idx)));
+
+                    switch (blk_width[idx]){
+                        case frame::STORED_WIDTH:
+                            blk_bytes[idx] = sizeof(uint8_t) + blk_inp_sz(idx);
+                            break;
+                        case 1u:
+                            blk_bytes[idx] = sizeof(uint8_t) + this->narrow_engine->encoded_size(blk_buf, blk_inp_sz(idx));
+                            break;
+                        default:
+                            blk_bytes[idx] = sizeof(uint8_t) + this->wide_engine->encoded_size(blk_buf, blk_inp_sz(idx));
+                            break;
+                    }
+                });
+
+                std::exclusive_scan(blk_bytes.begin(), blk_bytes.end(), blk_offs.begin(), frame::header_size(blk_count));
+                auto header = op_buf;
+                header      = dg::compact_serializer::core::serialize(static_cast<uint64_t>(inp_sz), header);
+                header      = dg::compact_serializer::core::serialize(static_cast<uint64_t>(this->block_sz), header);
+
+                for (size_t i = 0; i < blk_count; ++i){
+                    header  = dg::compact_serializer::core::serialize(static_cast<uint64_t>(blk_bytes[i]), header);
+                }
+
+                this->pool->parallel_for(blk_count, [&](size_t idx){
+                    auto rdbuf  = bit_array_type{};
+                    auto blk_op = dg::compact_serializer::core::serialize(blk_width[idx], op_buf + blk_offs[idx]);
+
+                    switch (blk_width[idx]){
+                        case frame::STORED_WIDTH:
+                            std::memcpy(blk_op, inp_buf + idx * this->block_sz, blk_inp_sz(idx));
+                            break;
+                        case 1u:
+                            this->narrow_engine->encode_into(inp_buf + idx * this->block_sz, blk_inp_sz(idx), blk_op, rdbuf);
+                            break;
+                        default:
+                            this->wide_engine->encode_into(inp_buf + idx * this->block_sz, blk_inp_sz(idx), blk_op, rdbuf);
+                            break;
+                    }
+                });
+
+                if (blk_count == 0u){
+                    return header;
+                }
+
+                return op_buf + blk_offs.back() + blk_bytes.back();
+            }
+
+            auto decode_into(const char * inp_buf, char * op_buf) const -> std::pair<const char *, char *>{
+
+                auto stats = stats::NoStats{};
+                return this->decode_into(inp_buf, op_buf, stats);
+            }
+
+            //blocks count into their own sink and are merged into stats once the pool is done
+            template <class Stats>
+            auto decode_into(const char * inp_buf, char * op_buf, Stats& stats) const -> std::pair<const char *, char *>{
+
+                auto inp_sz     = uint64_t{};
+                auto blk_sz     = uint64_t{};
+                inp_buf         = dg::compact_serializer::core::deserialize(inp_buf, inp_sz);
+                inp_buf         = dg::compact_serializer::core::deserialize(inp_buf, blk_sz);
+                auto blk_count  = frame::block_count(inp_sz, blk_sz);
+                auto blk_bytes  = std::vector<size_t>(blk_count);
+                auto blk_offs   = std::vector<size_t>(blk_count);
+                auto blk_stats  = std::vector<Stats>(blk_count);
+
+                for (size_t i = 0; i < blk_count; ++i){
+                    auto bytes      = uint64_t{};
+                    inp_buf         = dg::compact_serializer::core::deserialize(inp_buf, bytes);
+                    blk_bytes[i]    = bytes;
+                }
+
+                std::exclusive_scan(blk_bytes.begin(), blk_bytes.end(), blk_offs.begin(), size_t{0u});
+
+                this->pool->parallel_for(blk_count, [&](size_t idx){
+                    auto width      = uint8_t{};
+                    auto blk_buf    = dg::compact_serializer::core::deserialize(inp_buf + blk_offs[idx], width);
+                    auto blk_bit_sz = (blk_bytes[idx] - sizeof(uint8_t)) * CHAR_BIT;
+
+                    switch (width){
+                        case frame::STORED_WIDTH:
+                            std::memcpy(op_buf + idx * blk_sz, blk_buf, blk_bytes[idx] - sizeof(uint8_t));
+                            blk_stats[idx].stored(blk_bytes[idx] - sizeof(uint8_t));
+                            break;
+                        case 1u:
+                            this->narrow_engine->fast_decode_into(blk_buf, 0u, blk_bit_sz, op_buf + idx * blk_sz, blk_stats[idx]);
+                            break;
+                        case 2u:
+                            this->wide_engine->fast_decode_into(blk_buf, 0u, blk_bit_sz, op_buf + idx * blk_sz, blk_stats[idx]);
+                            break;
+                        default:
+                            std::abort();
+                    }
+                });
+
+                for (const auto& blk_stat: blk_stats){
+                    stats += blk_stat;
+                }
+
+                if (blk_count == 0u){
+                    return {inp_buf, op_buf};
+                }
+
+                return {inp_buf + blk_offs.back() + blk_bytes.back(), op_buf + inp_sz};
+            }
+
+            //decode_into over an untrusted frame - see FastEngine::checked_decode_into
+            auto checked_decode_into(const char * inp_buf, size_t inp_sz, char * op_buf, size_t op_cap) const -> std::pair<const char *, char *>{
+
+                auto stats = stats::NoStats{};
+                return this->checked_decode_into(inp_buf, inp_sz, op_buf, op_cap, stats);
+            }
+
+            template <class Stats>
+            auto checked_decode_into(const char * inp_buf, size_t inp_sz, char * op_buf, size_t op_cap, Stats& stats) const -> std::pair<const char *, char *>{
+
+                constexpr auto PREFIX_SZ    = sizeof(uint64_t) * 2;
+                auto inp_last               = inp_buf + inp_sz;
+                auto dec_sz                 = uint64_t{};
+                auto blk_sz                 = uint64_t{};
+
+                if (inp_sz < PREFIX_SZ){
+                    throw runtime_exception::CorruptedError{};
+                }
+
+                inp_buf = dg::compact_serializer::core::deserialize(inp_buf, dec_sz);
+                inp_buf = dg::compact_serializer::core::deserialize(inp_buf, blk_sz);
+
+                if (dec_sz != 0u && blk_sz == 0u){
+                    throw runtime_exception::CorruptedError{};
+                }
+
+                if (dec_sz > op_cap){
+                    throw runtime_exception::OutputOverflowError{};
+                }
+
+                auto blk_count = (dec_sz == 0u) ? size_t{0u} : static_cast<size_t>(dec_sz / blk_sz + (dec_sz % blk_sz != 0u));
+
+                if (blk_count > static_cast<size_t>(std::distance(inp_buf, inp_last)) / sizeof(uint64_t)){
+                    throw runtime_exception::CorruptedError{};
+                }
+
+                auto blk_bytes  = std::vector<size_t>(blk_count);
+                auto blk_offs   = std::vector<size_t>(blk_count);
+                auto blk_err    = std::vector<std::exception_ptr>(blk_count);
+                auto blk_stats  = std::vector<Stats>(blk_count);
+                auto data_sz    = static_cast<size_t>(std::distance(inp_buf, inp_last)) - blk_count * sizeof(uint64_t);
+                auto total_sz   = size_t{0u};
+
+                for (size_t i = 0; i < blk_count; ++i){
+                    auto bytes      = uint64_t{};
+                    inp_buf         = dg::compact_serializer::core::deserialize(inp_buf, bytes);
+
+                    if (bytes == 0u || bytes > data_sz - total_sz){
+                        throw runtime_exception::CorruptedError{};
+                    }
+
+                    blk_bytes[i]    = bytes;
+                    total_sz        += bytes;
+                }
+
+                std::exclusive_scan(blk_bytes.begin(), blk_bytes.end(), blk_offs.begin(), size_t{0u});
+
+                this->pool->parallel_for(blk_count, [&](size_t idx){
+                    auto blk_op_sz  = std::min(static_cast<size_t>(blk_sz), static_cast<size_t>(dec_sz - idx * blk_sz));
+                    auto blk_op     = op_buf + idx * blk_sz;
+                    auto width      = uint8_t{};
+                    auto blk_buf    = dg::compact_serializer::core::deserialize(inp_buf + blk_offs[idx], width);
+                    auto blk_inp_sz = blk_bytes[idx] - sizeof(uint8_t);
+
+                    try{
+                        auto last = std::add_pointer_t<char>();
+
+                        switch (width){
+                            case frame::STORED_WIDTH:
+                                if (blk_inp_sz != blk_op_sz){
+                                    throw runtime_exception::CorruptedError{};
+                                }
+
+                                std::memcpy(blk_op, blk_buf, blk_op_sz);
+                                blk_stats[idx].stored(blk_op_sz);
+                                last = blk_op + blk_op_sz;
+                                break;
+                            case 1u:
+                                last = this->narrow_engine->checked_decode_into(blk_buf, blk_inp_sz, blk_op, blk_op_sz, blk_stats[idx]).second;
+                                break;
+                            case 2u:
+                                last = this->wide_engine->checked_decode_into(blk_buf, blk_inp_sz, blk_op, blk_op_sz, blk_stats[idx]).second;
+                                break;
+                            default:
+                                throw runtime_exception::CorruptedError{};
+                        }
+
+                        if (static_cast<size_t>(std::distance(blk_op, last)) != blk_op_sz){
+                            throw runtime_exception::CorruptedError{};
+                        }
+                    } catch (...){
+                        blk_err[idx] = std::current_exception();
+                    }
+                });
+
+                for (const auto& err: blk_err){
+                    if (err){
+                        std::rethrow_exception(err);
+                    }
+                }
+
+                for (const auto& blk_stat: blk_stats){
+                    stats += blk_stat;
+                }
+
+                return {inp_buf + total_sz, op_buf + dec_sz};
+            }
+    };
+}
 
 namespace dg::huffman_encoder::user_interface{
 
     using namespace huffman_encoder::types; 
 
+    //ALPHABET_SIZE is the symbol width in bytes - the model, the engine and its streams must agree on it
+
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
     auto count(const char * buf, size_t sz) -> std::vector<size_t>{
 
-        return make::count(buf, sz);
+        return make::count<ALPHABET_SIZE>(buf, sz);
+    }
+
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto count(const char * buf, size_t sz, size_t thread_sz, size_t sample_stride = 1u) -> std::vector<size_t>{
+
+        auto pool = dg::thread_pool::WorkStealingPool(thread_sz);
+        return make::count<ALPHABET_SIZE>(buf, sz, pool, sample_stride);
+    }
+
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto build(std::vector<size_t> counter, size_t max_code_length = constants::DEFAULT_MAX_CODE_LENGTH) -> model::Tree{
+
+        return make::build<ALPHABET_SIZE>(make::clamp(std::move(counter)), max_code_length);
+    }
+
+    //rle_escape adds a run-length escape code - long repeats of one symbol (zero pages) then cost a few bytes and decode with memset
+    //the engine tables live in one image from allocator - engine_image::HugePageAllocator backs them with 2MB pages
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto spawn_fast_engine(const model::Tree& huffman_tree, bool rle_escape = false, memory::ImageAllocator& allocator = memory::default_allocator()) -> std::unique_ptr<core::FastEngine<ALPHABET_SIZE>>{
+
+        auto delim_tree     = make::to_delim_tree<ALPHABET_SIZE>(huffman_tree, rle_escape);
+        auto [image, sz]    = make::to_image<ALPHABET_SIZE>(delim_tree, image::FULL_ROLE, allocator);
+        auto image_ptr      = image.get();
+
+        return std::make_unique<core::FastEngine<ALPHABET_SIZE>>(std::move(image), image_ptr);
+    }
+
+    //zero-copy engine over an image produced by core::FastEngine::get_image - the buffer must outlive the engine
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto spawn_fast_engine_view(const char * image, size_t image_sz, bool verify_checksum = true) -> std::unique_ptr<core::FastEngine<ALPHABET_SIZE>>{
+
+        image::verify<ALPHABET_SIZE>(image, image_sz, verify_checksum);
+        return std::make_unique<core::FastEngine<ALPHABET_SIZE>>(nullptr, image);
+    }
+
+    //legacy model::Node trees are not length-limited - one whose codes, delimiters included, exceed MAX_CODE_LENGTH bits
+    //throws CorruptedError; rebuild such a model from its histogram with build
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto spawn_fast_engine(model::Node * huffman_tree, bool rle_escape = false, memory::ImageAllocator& allocator = memory::default_allocator()) -> std::unique_ptr<core::FastEngine<ALPHABET_SIZE>>{
+
+        return spawn_fast_engine<ALPHABET_SIZE>(make::to_tree(huffman_tree), rle_escape, allocator);
+    }
+
+    //a non-canonical tree comes back as its canonical equivalent, which assigns different codes
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto to_compact_model(const model::Tree& huffman_tree) -> model::CodeLengthModel{
+
+        return make::pack_code_length(make::to_code_length<ALPHABET_SIZE>(huffman_tree));
     }
 
-    auto build(std::vector<size_t> counter) -> std::unique_ptr<model::Node>{
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto from_compact_model(const model::CodeLengthModel& compact_model) -> model::Tree{
 
-        auto counter_node   = make::build(make::clamp(std::move(counter)));
-        return make::to_model(counter_node.get());
+        return make::to_canonical_tree<ALPHABET_SIZE>(make::unpack_code_length<ALPHABET_SIZE>(compact_model));
     }
 
-    auto spawn_fast_engine(model::Node * huffman_tree) -> std::unique_ptr<core::FastEngine>{
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto spawn_fast_engine(const model::CodeLengthModel& compact_model, bool rle_escape = false, memory::ImageAllocator& allocator = memory::default_allocator()) -> std::unique_ptr<core::FastEngine<ALPHABET_SIZE>>{
 
-        auto decoding_tree  = make::to_delim_tree(huffman_tree);
-        auto decoding_dict  = make::decode_dictionarize(decoding_tree.get());
-        auto encoding_dict  = make::encode_dictionarize(decoding_tree.get());
-        auto delim          = make::find_delim(decoding_tree.get());
+        return spawn_fast_engine<ALPHABET_SIZE>(from_compact_model<ALPHABET_SIZE>(compact_model), rle_escape, allocator);
+    }
+
+    //one-way halves of spawn_fast_engine for services that only encode or only decode - each image holds just its own tables,
+    //and a decode engine builds them on first use
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto spawn_encode_engine(const model::Tree& huffman_tree, bool rle_escape = false, memory::ImageAllocator& allocator = memory::default_allocator()) -> std::unique_ptr<core::EncodeEngine<ALPHABET_SIZE>>{
+
+        auto delim_tree     = make::to_delim_tree<ALPHABET_SIZE>(huffman_tree, rle_escape);
+        auto [image, sz]    = make::to_image<ALPHABET_SIZE>(delim_tree, image::ENCODE_ROLE, allocator);
+        auto image_ptr      = image.get();
+
+        return std::make_unique<core::EncodeEngine<ALPHABET_SIZE>>(std::move(image), image_ptr);
+    }
+
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto spawn_encode_engine(const model::CodeLengthModel& compact_model, bool rle_escape = false, memory::ImageAllocator& allocator = memory::default_allocator()) -> std::unique_ptr<core::EncodeEngine<ALPHABET_SIZE>>{
+
+        return spawn_encode_engine<ALPHABET_SIZE>(from_compact_model<ALPHABET_SIZE>(compact_model), rle_escape, allocator);
+    }
+
+    //allocator must outlive the first decode
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto spawn_decode_engine(model::Tree huffman_tree, bool rle_escape = false, memory::ImageAllocator& allocator = memory::default_allocator()) -> std::unique_ptr<core::DecodeEngine<ALPHABET_SIZE>>{
+
+        return std::make_unique<core::DecodeEngine<ALPHABET_SIZE>>(std::move(huffman_tree), rle_escape, allocator);
+    }
+
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto spawn_decode_engine(const model::CodeLengthModel& compact_model, bool rle_escape = false, memory::ImageAllocator& allocator = memory::default_allocator()) -> std::unique_ptr<core::DecodeEngine<ALPHABET_SIZE>>{
+
+        return spawn_decode_engine<ALPHABET_SIZE>(from_compact_model<ALPHABET_SIZE>(compact_model), rle_escape, allocator);
+    }
+
+    template <size_t ALPHABET_SIZE>
+    auto spawn_stream_encoder(const core::FastEngine<ALPHABET_SIZE>& engine) -> std::unique_ptr<core::StreamEncoder<ALPHABET_SIZE>>{
+
+        return std::make_unique<core::StreamEncoder<ALPHABET_SIZE>>(&engine);
+    }
 
-        auto transformed_ed = utility::vector_transform(encoding_dict, static_cast<bit_array_type(*)(const std::vector<bool>&)>(bit_array::to_bit_array));
-        auto transformed_dl = utility::vector_transform(delim, static_cast<bit_array_type(*)(const std::vector<bool>&)>(bit_array::to_bit_array));
-        auto engine         = core::FastEngine(std::move(transformed_ed), std::move(transformed_dl), std::move(decoding_tree), std::move(decoding_dict));
+    template <size_t ALPHABET_SIZE>
+    auto spawn_stream_decoder(const core::FastEngine<ALPHABET_SIZE>& engine) -> std::unique_ptr<core::StreamDecoder<ALPHABET_SIZE>>{
 
-        return std::make_unique<core::FastEngine>(std::move(engine));
+        return std::make_unique<core::StreamDecoder<ALPHABET_SIZE>>(&engine);
     }
 
-    auto spawn_row_engine(std::vector<std::unique_ptr<core::FastEngine>> engines) -> std::unique_ptr<core::RowEncodingEngine>{
+    auto spawn_row_engine(std::vector<core::AnyFastEngine> engines) -> std::unique_ptr<core::RowEncodingEngine>{
 
         return std::make_unique<core::RowEncodingEngine>(std::move(engines));
     }
+
+    template <size_t ALPHABET_SIZE>
+    auto spawn_row_engine(std::vector<std::unique_ptr<core::FastEngine<ALPHABET_SIZE>>> engines) -> std::unique_ptr<core::RowEncodingEngine>{
+
+        return spawn_row_engine(std::vector<core::AnyFastEngine>(std::make_move_iterator(engines.begin()), std::make_move_iterator(engines.end())));
+    }
+
+    template <size_t ALPHABET_SIZE>
+    auto spawn_frame_engine(std::unique_ptr<core::FastEngine<ALPHABET_SIZE>> engine, 
+                            size_t block_sz = constants::DEFAULT_FRAME_BLOCK_SZ, 
+                            size_t thread_sz = std::thread::hardware_concurrency()) -> std::unique_ptr<core::FrameEngine<ALPHABET_SIZE>>{
+
+        if (block_sz == 0u || block_sz % ALPHABET_SIZE != 0u){
+            std::abort();
+        }
+
+        auto pool = std::make_unique<dg::thread_pool::WorkStealingPool>(thread_sz);
+        return std::make_unique<core::FrameEngine<ALPHABET_SIZE>>(std::move(engine), std::move(pool), block_sz);
+    }
+
+    //wide_min_gain is in percent - 0 always takes the smaller estimate
+    auto spawn_adaptive_frame_engine(std::unique_ptr<core::FastEngine<1u>> narrow_engine,
+                                     std::unique_ptr<core::FastEngine<2u>> wide_engine,
+                                     size_t block_sz = constants::DEFAULT_FRAME_BLOCK_SZ,
+                                     size_t thread_sz = std::thread::hardware_concurrency(),
+                                     size_t wide_min_gain = constants::DEFAULT_WIDE_MIN_GAIN) -> std::unique_ptr<core::AdaptiveFrameEngine>{
+
+        if (block_sz == 0u || block_sz % 2u != 0u || wide_min_gain >= 100u){
+            std::abort();
+        }
+
+        auto pool = std::make_unique<dg::thread_pool::WorkStealingPool>(thread_sz);
+        return std::make_unique<core::AdaptiveFrameEngine>(std::move(narrow_engine), std::move(wide_engine), std::move(pool), block_sz, wide_min_gain);
+    }
 }
 
 #endif
\ No newline at end of file
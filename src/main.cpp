@@ -35,14 +35,11 @@ int main(){
 
         auto sz     = rand_dev();
         auto buf    = randomize_buf(sz);
-        auto d      = build(count(buf.get(), sz));
+        auto d      = to_compact_model(build(count(buf.get(), sz)));
         auto sd     = dg::compact_serializer::serialize(d);
         auto ds     = dg::compact_serializer::deserialize<decltype(d)>(sd.first.get(), sd.second);
-        auto e      = spawn_fast_engine(ds.get());
-        auto bbuf   = std::unique_ptr<char[]>(new char[dg::huffman_encoder::constants::MAX_ENCODING_SZ_PER_BYTE * sz]);
-        auto rdbuf  = dg::huffman_encoder::types::bit_array_type{};
-        auto last   = e->encode_into(buf.get(), sz, bbuf.get(), rdbuf);
-        auto span   = std::distance(bbuf.get(), last);
+        auto e      = spawn_fast_engine(ds);
+        auto [bbuf, span] = e->encode(buf.get(), sz);
         
         auto decoded    = std::unique_ptr<char[]>(new char[dg::huffman_encoder::constants::MAX_DECODING_SZ_PER_BYTE * span]);
         auto [_, llast] = e->fast_decode_into(bbuf.get(), 0u, span * CHAR_BIT, decoded.get());
@@ -0,0 +1,130 @@
+#ifndef __DG_PERF_COUNTER__
+#define __DG_PERF_COUNTER__
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+//Linux perf_event_open counters for the calling thread - user space only, so perf_event_paranoid <= 2 is enough
+//the counters form one perf group, so the kernel schedules them together and ratios such as IPC come from the same time slices
+//a counter the host cannot provide (no PMU in a VM, paranoid too strict) stays unavailable and the rest keep working
+
+namespace dg::perf_counter{
+
+    static inline constexpr size_t CYCLES           = 0;
+    static inline constexpr size_t INSTRUCTIONS     = 1;
+    static inline constexpr size_t CACHE_MISSES     = 2;
+    static inline constexpr size_t BRANCH_MISSES    = 3;
+    static inline constexpr size_t TASK_CLOCK       = 4;    //nanoseconds, software event - available wherever perf_event_open is
+    static inline constexpr size_t EVENT_SZ         = 5;
+
+    struct Sample{
+        std::array<uint64_t, EVENT_SZ> value;
+        std::array<bool, EVENT_SZ> is_available;
+    };
+
+    class CounterGroup{
+
+        private:
+
+            std::array<int, EVENT_SZ> fd;  //-1 for an unavailable event
+            int leader;                     //first event that opened, -1 if none did
+
+        public:
+
+            CounterGroup(): leader(-1){
+
+                static constexpr std::array<std::pair<uint32_t, uint64_t>, EVENT_SZ> EVENT = {{
+                    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+                    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+                    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK}
+                }};
+
+                for (size_t i = 0; i < EVENT_SZ; ++i){
+                    auto attr           = perf_event_attr{};
+                    attr.size           = sizeof(perf_event_attr);
+                    attr.type           = EVENT[i].first;
+                    attr.config         = EVENT[i].second;
+                    attr.disabled       = this->leader == -1; //members follow the leader
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv     = 1;
+                    attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                    this->fd[i]         = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, this->leader, 0));
+
+                    if (this->leader == -1){
+                        this->leader = this->fd[i];
+                    }
+                }
+            }
+
+            CounterGroup(const CounterGroup&) = delete;
+            CounterGroup& operator =(const CounterGroup&) = delete;
+
+            ~CounterGroup() noexcept{
+
+                for (int fd: this->fd){
+                    if (fd != -1){
+                        ::close(fd);
+                    }
+                }
+            }
+
+            auto is_available(size_t event) const noexcept -> bool{
+
+                return this->fd[event] != -1;
+            }
+
+            void start() noexcept{
+
+                if (this->leader != -1){
+                    ::ioctl(this->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                    ::ioctl(this->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+                }
+            }
+
+            //values are scaled up when the kernel multiplexed the group - all by the same factor
+            auto stop() noexcept -> Sample{
+
+                auto rs = Sample{};
+
+                if (this->leader == -1){
+                    return rs;
+                }
+
+                ::ioctl(this->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+                uint64_t buf[3 + EVENT_SZ] = {}; //nr, time_enabled, time_running, then one value per member in open order
+                auto sz = ::read(this->leader, buf, sizeof(buf));
+
+                if (sz < static_cast<ssize_t>(3 * sizeof(uint64_t)) || static_cast<size_t>(sz) != (3 + buf[0]) * sizeof(uint64_t) || buf[2] == 0u){
+                    return rs;
+                }
+
+                for (size_t i = 0, member = 0; i < EVENT_SZ; ++i){
+                    if (this->fd[i] == -1){
+                        continue;
+                    }
+
+                    rs.value[i]         = static_cast<uint64_t>(static_cast<double>(buf[3 + member++]) * buf[1] / buf[2]);
+                    rs.is_available[i]  = true;
+                }
+
+                return rs;
+            }
+
+            template <class Executable>
+            auto measure(Executable&& exe) -> Sample{
+
+                this->start();
+                exe();
+                return this->stop();
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __DG_HUFFMAN_TEST__
+#define __DG_HUFFMAN_TEST__
+
+#include "huffman_encoder.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+//shared by the test_*.cpp regression programs - each one builds on its own (g++ -std=c++20 -O2 -I src src/test_stream_encoder.cpp)
+//and exits non-zero at the first failed check; every input comes from a fixed seed, so a failure reproduces run to run
+
+#define DG_CHECK(cond) dg::huffman_encoder::test::check(static_cast<bool>(cond), #cond, __FILE__, __LINE__)
+
+namespace dg::huffman_encoder::test{
+
+    inline void check(bool is_ok, const char * cond, const char * file, int line){
+
+        if (!is_ok){
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, cond);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    //true if exe throws Exception - any other exception escapes and fails the program
+    template <class Exception, class Executable>
+    auto throws(Executable exe) -> bool{
+
+        try{
+            exe();
+        } catch (const Exception&){
+            return true;
+        }
+
+        return false;
+    }
+
+    enum class Shape{
+        uniform,    //incompressible
+        skewed,     //geometric - a few short codes and a long tail of rare ones
+        sparse      //mostly zero pages with short bursts, the rle escape case
+    };
+
+    inline auto make_data(Shape shape, size_t sz, std::mt19937& gen) -> std::string{
+
+        auto rs     = std::string(sz, '\0');
+        auto geo    = std::geometric_distribution<int>(0.25);
+
+        for (size_t i = 0; i < sz; ++i){
+            switch (shape){
+                case Shape::uniform:
+                    rs[i] = static_cast<char>(gen());
+                    break;
+                case Shape::skewed:
+                    rs[i] = static_cast<char>(geo(gen));
+                    break;
+                case Shape::sparse:
+                    break;
+            }
+        }
+
+        //zero runs of up to 512 bytes, most of them past RLE_MIN_REPEAT_SZ
+        if (shape == Shape::sparse){
+            for (size_t i = 0; i < sz; i += 1 + gen() % 512){
+                rs[i] = static_cast<char>(gen());
+            }
+        }
+
+        return rs;
+    }
+
+    //build clamps unseen symbols to a count of one, so the model encodes any input of its width
+    template <size_t ALPHABET_SIZE = constants::DEFAULT_ALPHABET_SIZE>
+    auto make_model(Shape shape, std::mt19937& gen, size_t max_code_length = constants::DEFAULT_MAX_CODE_LENGTH) -> model::Tree{
+
+        auto train = make_data(shape, size_t{1} << 18, gen);
+        return user_interface::build<ALPHABET_SIZE>(user_interface::count<ALPHABET_SIZE>(train.data(), train.size()), max_code_length);
+    }
+}
+
+#endif
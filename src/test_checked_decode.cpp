@@ -0,0 +1,119 @@
+#include "test.h"
+#include <algorithm>
+#include <cstring>
+
+//checked_decode_into over exact-size buffers - build with -fsanitize=address so a read or write past either bound fails the run
+
+using namespace dg::huffman_encoder;
+
+auto to_vector(const char * buf, size_t sz) -> std::vector<char>{
+
+    return std::vector<char>(buf, buf + sz);
+}
+
+//a corrupted input may still decode to something - what it must not do is leave the bounds or throw anything else
+template <class Engine>
+void check_contained(const Engine& engine, const std::vector<char>& inp, size_t op_cap){
+
+    auto op = std::vector<char>(op_cap);
+
+    try{
+        auto [inp_last, op_last] = engine.checked_decode_into(inp.data(), inp.size(), op.data(), op.size());
+        DG_CHECK(inp_last <= inp.data() + inp.size());
+        DG_CHECK(op_last <= op.data() + op.size());
+    } catch (const runtime_exception::CorruptedError&){
+    } catch (const runtime_exception::OutputOverflowError&){
+    }
+}
+
+template <size_t ALPHABET_SIZE>
+void test_engine(test::Shape shape, bool rle_escape, uint32_t seed){
+
+    auto gen    = std::mt19937{seed};
+    auto engine = user_interface::spawn_fast_engine<ALPHABET_SIZE>(test::make_model<ALPHABET_SIZE>(shape, gen), rle_escape);
+
+    for (size_t sz: {size_t{0u}, size_t{ALPHABET_SIZE}, size_t{7u}, size_t{64u}, size_t{4097u}, size_t{50000u}}){
+        sz          -= sz % ALPHABET_SIZE;
+        auto data   = test::make_data(shape, sz, gen);
+        auto [buf, buf_sz] = engine->encode(data.data(), data.size());
+        auto enc    = to_vector(buf.get(), buf_sz);
+        auto op     = std::vector<char>(sz);
+
+        auto [inp_last, op_last] = engine->checked_decode_into(enc.data(), enc.size(), op.data(), op.size());
+        DG_CHECK(inp_last == enc.data() + enc.size());
+        DG_CHECK(op_last == op.data() + op.size());
+        DG_CHECK(std::equal(op.begin(), op.end(), data.begin()));
+
+        if (sz != 0u){
+            auto short_op = std::vector<char>(sz - 1u);
+            DG_CHECK(test::throws<runtime_exception::OutputOverflowError>([&]{engine->checked_decode_into(enc.data(), enc.size(), short_op.data(), short_op.size());}));
+        }
+
+        //the delimiter closes the message, so any cut loses it
+        for (size_t cut = 1u; cut <= std::min(enc.size(), size_t{16u}); ++cut){
+            auto truncated = std::vector<char>(enc.begin(), enc.end() - cut);
+            DG_CHECK(test::throws<runtime_exception::CorruptedError>([&]{engine->checked_decode_into(truncated.data(), truncated.size(), op.data(), op.size());}));
+        }
+
+        for (size_t i = 0; i < 64u && !enc.empty(); ++i){
+            auto flipped = enc;
+            flipped[gen() % flipped.size()] ^= static_cast<char>(1u << (gen() % CHAR_BIT));
+            check_contained(*engine, flipped, sz);
+        }
+    }
+
+    for (size_t i = 0; i < 64u; ++i){
+        auto junk = test::make_data(test::Shape::uniform, gen() % 512u, gen);
+        check_contained(*engine, to_vector(junk.data(), junk.size()), gen() % 4096u);
+    }
+}
+
+void test_frame(){
+
+    constexpr size_t BLOCK_SZ = 4096;
+    auto gen    = std::mt19937{17u};
+    auto data   = test::make_data(test::Shape::skewed, BLOCK_SZ * 5 + 123, gen);
+    auto engine = user_interface::spawn_frame_engine(user_interface::spawn_fast_engine<1u>(test::make_model<1u>(test::Shape::skewed, gen)), BLOCK_SZ, 2u);
+    auto enc    = std::vector<char>(frame::max_encoding_size(data.size(), BLOCK_SZ));
+    enc.resize(std::distance(enc.data(), engine->encode_into(data.data(), data.size(), enc.data())));
+    auto op     = std::vector<char>(data.size());
+
+    auto [inp_last, op_last] = engine->checked_decode_into(enc.data(), enc.size(), op.data(), op.size());
+    DG_CHECK(inp_last == enc.data() + enc.size());
+    DG_CHECK(op_last == op.data() + op.size());
+    DG_CHECK(std::equal(op.begin(), op.end(), data.begin()));
+
+    auto short_op = std::vector<char>(data.size() - 1u);
+    DG_CHECK(test::throws<runtime_exception::OutputOverflowError>([&]{engine->checked_decode_into(enc.data(), enc.size(), short_op.data(), short_op.size());}));
+
+    for (size_t cut: {size_t{1u}, size_t{100u}, enc.size() - frame::header_size(frame::block_count(data.size(), BLOCK_SZ)), enc.size() - 1u}){
+        auto truncated = std::vector<char>(enc.begin(), enc.end() - cut);
+        DG_CHECK(test::throws<runtime_exception::CorruptedError>([&]{engine->checked_decode_into(truncated.data(), truncated.size(), op.data(), op.size());}));
+    }
+
+    //block_sz of zero with a non-empty frame, then a block length past the end of the input
+    auto zero_blk = enc;
+    std::memset(zero_blk.data() + sizeof(uint64_t), 0, sizeof(uint64_t));
+    DG_CHECK(test::throws<runtime_exception::CorruptedError>([&]{engine->checked_decode_into(zero_blk.data(), zero_blk.size(), op.data(), op.size());}));
+
+    auto long_blk = enc;
+    std::memset(long_blk.data() + sizeof(uint64_t) * 2, 0xff, sizeof(uint64_t));
+    DG_CHECK(test::throws<runtime_exception::CorruptedError>([&]{engine->checked_decode_into(long_blk.data(), long_blk.size(), op.data(), op.size());}));
+
+    for (size_t i = 0; i < 256u; ++i){
+        auto flipped = enc;
+        flipped[gen() % flipped.size()] ^= static_cast<char>(1u << (gen() % CHAR_BIT));
+        check_contained(*engine, flipped, data.size());
+    }
+}
+
+int main(){
+
+    test_engine<1u>(test::Shape::skewed, false, 1u);
+    test_engine<1u>(test::Shape::uniform, false, 2u);
+    test_engine<1u>(test::Shape::sparse, true, 3u);
+    test_engine<2u>(test::Shape::skewed, false, 4u);
+    test_engine<2u>(test::Shape::sparse, true, 5u);
+    test_frame();
+    std::puts("test_checked_decode: ok");
+}
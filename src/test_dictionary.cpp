@@ -0,0 +1,164 @@
+#include "test.h"
+#include "dictionary.h"
+#include <algorithm>
+#include <thread>
+
+//dictionary registry - stable ids, id conflicts, LRU eviction under concurrent use and malformed messages
+
+using namespace dg::huffman_encoder;
+
+//small JSON-like records, the many-small-messages case the registry is for
+auto make_record(std::mt19937& gen, size_t kind) -> std::string{
+
+    static const char * KEYS[] = {"user", "id", "status", "amount", "currency", "timestamp", "region"};
+
+    auto rs         = std::string{"{"};
+    auto field_sz   = 2u + gen() % 12u;
+
+    for (size_t i = 0u; i < field_sz; ++i){
+        rs += std::string{"\""} + KEYS[(gen() + kind) % 7u] + "\":";
+        rs += (kind == 0u) ? std::to_string(gen() % 100000u) : "\"" + std::string(1u + gen() % 8u, static_cast<char>('a' + gen() % 26u)) + "\"";
+        rs += ',';
+    }
+
+    rs.back() = '}';
+    return rs;
+}
+
+auto train(size_t kind, size_t alphabet_sz, size_t max_code_length, std::mt19937& gen) -> dictionary::Dictionary{
+
+    auto records    = std::vector<std::string>{};
+    auto corpus     = std::vector<std::pair<const char *, size_t>>{};
+
+    for (size_t i = 0u; i < 2000u; ++i){
+        records.push_back(make_record(gen, kind));
+    }
+
+    for (const auto& record: records){
+        corpus.emplace_back(record.data(), record.size());
+    }
+
+    return (alphabet_sz == 1u) ? dictionary::train<1u>(corpus, max_code_length) : dictionary::train<2u>(corpus, max_code_length);
+}
+
+void check_round_trip(const dictionary::Registry& registry, dictionary::dictionary_id_type id, const std::string& data){
+
+    auto [enc, enc_sz] = registry.encode(id, data.data(), data.size());
+    DG_CHECK(enc_sz <= dictionary::max_message_size(data.size()));
+
+    auto [dec, dec_sz] = registry.decode(enc.get(), enc_sz);
+    DG_CHECK(std::string(dec.get(), dec_sz) == data);
+}
+
+void test_ids(){
+
+    auto gen    = std::mt19937{1u};
+    auto dict   = train(0u, 1u, constants::DEFAULT_MAX_CODE_LENGTH, gen);
+    auto other  = train(1u, 2u, constants::DEFAULT_MAX_CODE_LENGTH, gen);
+
+    //the id is a hash of the serialized dictionary, so it survives a round trip through storage
+    auto [buf, sz] = dg::compact_serializer::serialize(dict);
+    DG_CHECK(dictionary::id_of(dg::compact_serializer::deserialize<dictionary::Dictionary>(buf.get(), sz)) == dictionary::id_of(dict));
+    DG_CHECK(dictionary::id_of(dict) != dictionary::id_of(other));
+
+    auto registry   = dictionary::spawn_registry(2u);
+    auto id         = registry->add(dict);
+
+    DG_CHECK(id == dictionary::id_of(dict) && registry->contains(id));
+    DG_CHECK(registry->add(dict) == id);
+    registry->add(id, dict);
+
+    DG_CHECK(test::throws<runtime_exception::DictionaryIdConflictError>([&]{registry->add(id, other);}));
+    check_round_trip(*registry, id, "{\"user\":1}");
+
+    auto bad_width          = other;
+    bad_width.alphabet_sz   = 3u;
+    DG_CHECK(test::throws<runtime_exception::CorruptedError>([&]{registry->add(bad_width);}));
+
+    DG_CHECK(!registry->contains(id + 1u));
+    DG_CHECK(test::throws<runtime_exception::UnknownDictionaryError>([&]{registry->encode(id + 1u, "x", 1u);}));
+}
+
+//three dictionaries through a two-engine cache from several threads, so lookups keep evicting and rebuilding engines
+void test_concurrent_eviction(){
+
+    auto gen        = std::mt19937{2u};
+    auto registry   = dictionary::spawn_registry(2u);
+    auto id         = std::vector<dictionary::dictionary_id_type>{};
+
+    id.push_back(registry->add(train(0u, 1u, constants::DEFAULT_MAX_CODE_LENGTH, gen)));
+    id.push_back(registry->add(train(1u, 2u, constants::DEFAULT_MAX_CODE_LENGTH, gen)));
+    id.push_back(registry->add(train(1u, 1u, 12u, gen)));
+
+    auto workers = std::vector<std::thread>{};
+
+    for (uint32_t seed = 0u; seed < 4u; ++seed){
+        workers.emplace_back([&, seed]{
+            auto gen = std::mt19937{seed};
+
+            for (size_t i = 0u; i < 300u; ++i){
+                auto kind = gen() % 3u;
+                check_round_trip(*registry, id[kind], make_record(gen, kind == 0u ? 0u : 1u));
+            }
+        });
+    }
+
+    for (auto& worker: workers){
+        worker.join();
+    }
+
+    //empty and incompressible messages - the latter are stored, payload size equal to the decoded size
+    auto noise          = test::make_data(test::Shape::uniform, 300u, gen);
+    auto [enc, enc_sz]  = registry->encode(id[1], noise.data(), noise.size());
+
+    DG_CHECK(enc_sz == dictionary::max_message_size(noise.size()) - dictionary::MAX_VARINT_SZ + 2u);
+    check_round_trip(*registry, id[1], noise);
+    check_round_trip(*registry, id[0], std::string{});
+}
+
+void test_malformed(){
+
+    auto gen            = std::mt19937{3u};
+    auto registry       = dictionary::spawn_registry();
+    auto id             = registry->add(train(0u, 1u, constants::DEFAULT_MAX_CODE_LENGTH, gen));
+    auto data           = make_record(gen, 0u);
+    auto [enc, enc_sz]  = registry->encode(id, data.data(), data.size());
+    auto op             = std::vector<char>(data.size());
+    auto decode         = [&](const std::vector<char>& msg, size_t op_cap){registry->decode_into(msg.data(), msg.size(), op.data(), op_cap);};
+
+    DG_CHECK(enc_sz < dictionary::max_message_size(data.size()) - dictionary::MAX_VARINT_SZ);
+    DG_CHECK(test::throws<runtime_exception::OutputOverflowError>([&]{decode(std::vector<char>(enc.get(), enc.get() + enc_sz), data.size() - 1u);}));
+
+    //any cut - through the id, the size varint or the coded payload - is corrupted
+    for (size_t sz = 0u; sz < enc_sz; ++sz){
+        DG_CHECK(test::throws<runtime_exception::CorruptedError>([&]{decode(std::vector<char>(enc.get(), enc.get() + sz), op.size());}));
+    }
+
+    auto unknown = std::vector<char>(enc.get(), enc.get() + enc_sz);
+    unknown[0] ^= 1;
+    DG_CHECK(test::throws<runtime_exception::UnknownDictionaryError>([&]{decode(unknown, op.size());}));
+
+    //a size varint that never ends
+    auto endless = std::vector<char>(sizeof(dictionary::dictionary_id_type) + dictionary::MAX_VARINT_SZ + 1u, '\xff');
+    std::copy(enc.get(), enc.get() + sizeof(dictionary::dictionary_id_type), endless.begin());
+    DG_CHECK(test::throws<runtime_exception::CorruptedError>([&]{decode(endless, op.size());}));
+
+    for (size_t i = 0u; i < 256u; ++i){
+        auto flipped = std::vector<char>(enc.get(), enc.get() + enc_sz);
+        flipped[sizeof(dictionary::dictionary_id_type) + gen() % (enc_sz - sizeof(dictionary::dictionary_id_type))] ^= static_cast<char>(1u << (gen() % CHAR_BIT));
+
+        try{
+            decode(flipped, op.size());
+        } catch (const runtime_exception::CorruptedError&){
+        } catch (const runtime_exception::OutputOverflowError&){
+        }
+    }
+}
+
+int main(){
+
+    test_ids();
+    test_concurrent_eviction();
+    test_malformed();
+    std::puts("test_dictionary: ok");
+}
@@ -0,0 +1,176 @@
+#include "test.h"
+#include "engine_image.h"
+#include <cstdlib>
+#include <cstring>
+
+//prebuilt engine images - views, files and the checks image::verify makes before an engine trusts one
+
+using namespace dg::huffman_encoder;
+
+struct AlignedFree{
+
+    void operator()(char * buf) const noexcept{
+
+        std::free(buf);
+    }
+};
+
+using aligned_buffer = std::unique_ptr<char, AlignedFree>;
+
+//offs bytes past a SECTION_ALIGNMENT boundary
+auto copy_image(const char * image, size_t image_sz, size_t offs = 0u) -> aligned_buffer{
+
+    auto rs = aligned_buffer(static_cast<char *>(std::aligned_alloc(image::SECTION_ALIGNMENT, image::align(image_sz + offs))));
+    std::memcpy(rs.get() + offs, image, image_sz);
+
+    return rs;
+}
+
+template <size_t ALPHABET_SIZE>
+void check_same_engine(const core::FastEngine<ALPHABET_SIZE>& lhs, const core::FastEngine<ALPHABET_SIZE>& rhs, const std::string& data){
+
+    auto [lhs_enc, lhs_sz]  = lhs.encode(data.data(), data.size());
+    auto [rhs_enc, rhs_sz]  = rhs.encode(data.data(), data.size());
+    auto dec                = std::vector<char>(data.size());
+
+    DG_CHECK(lhs_sz == rhs_sz && std::memcmp(lhs_enc.get(), rhs_enc.get(), lhs_sz) == 0);
+
+    auto [_, last] = rhs.checked_decode_into(lhs_enc.get(), lhs_sz, dec.data(), dec.size());
+    DG_CHECK(last == dec.data() + dec.size() && std::equal(dec.begin(), dec.end(), data.begin()));
+}
+
+template <size_t ALPHABET_SIZE>
+void test_round_trip(test::Shape shape, bool rle_escape, uint32_t seed){
+
+    auto gen                = std::mt19937{seed};
+    auto tree               = test::make_model<ALPHABET_SIZE>(shape, gen);
+    auto engine             = user_interface::spawn_fast_engine<ALPHABET_SIZE>(tree, rle_escape);
+    auto [image, image_sz]  = engine->get_image();
+    auto data               = test::make_data(shape, size_t{1} << 15, gen);
+
+    //images are reproducible - the same model always builds the same bytes, padding included
+    auto rebuilt            = user_interface::spawn_fast_engine<ALPHABET_SIZE>(tree, rle_escape);
+    auto [again, again_sz]  = rebuilt->get_image();
+    DG_CHECK(image_sz == again_sz && std::memcmp(image, again, image_sz) == 0);
+
+    auto copy = copy_image(image, image_sz);
+    check_same_engine(*engine, *user_interface::spawn_fast_engine_view<ALPHABET_SIZE>(copy.get(), image_sz), data);
+
+    char path[] = "/tmp/dg_huffman_image_XXXXXX";
+    auto fd     = ::mkstemp(path);
+    DG_CHECK(fd != -1);
+    ::close(fd);
+
+    engine_image::save(*engine, path);
+    check_same_engine(*engine, *engine_image::load<ALPHABET_SIZE>(path), data);
+    ::unlink(path);
+}
+
+template <size_t ALPHABET_SIZE, class Mutator>
+auto is_rejected(const char * image, size_t image_sz, Mutator mutate, bool verify_checksum = true) -> bool{
+
+    auto copy = copy_image(image, image_sz);
+    auto sz   = mutate(copy.get(), image_sz);
+
+    return test::throws<runtime_exception::CorruptedError>([&]{user_interface::spawn_fast_engine_view<ALPHABET_SIZE>(copy.get(), sz, verify_checksum);});
+}
+
+void test_corruption(){
+
+    auto gen                = std::mt19937{9u};
+    auto engine             = user_interface::spawn_fast_engine<1u>(test::make_model<1u>(test::Shape::skewed, gen));
+    auto [image, image_sz]  = engine->get_image();
+    auto header_field       = [](size_t offs, uint64_t value){
+        return [=](char * buf, size_t sz){
+            std::memcpy(buf + offs, &value, sizeof(uint64_t));
+            return sz;
+        };
+    };
+
+    DG_CHECK(!is_rejected<1u>(image, image_sz, [](char *, size_t sz){return sz;}));
+
+    //a flipped table byte fails the checksum
+    for (size_t i = 0; i < 64u; ++i){
+        auto offs = sizeof(image::Header) + gen() % (image_sz - sizeof(image::Header));
+        DG_CHECK((is_rejected<1u>(image, image_sz, [=](char * buf, size_t sz){buf[offs] ^= 1; return sz;})));
+    }
+
+    DG_CHECK((is_rejected<1u>(image, image_sz, [](char *, size_t sz){return sz - 1u;})));
+    DG_CHECK((is_rejected<1u>(image, image_sz, [](char *, size_t){return sizeof(image::Header) - 1u;})));
+    DG_CHECK((is_rejected<2u>(image, image_sz, [](char *, size_t sz){return sz;})));
+    DG_CHECK((is_rejected<1u>(image, image_sz, header_field(offsetof(image::Header, magic), 0u))));
+    DG_CHECK((is_rejected<1u>(image, image_sz, header_field(offsetof(image::Header, version), image::VERSION - 1u))));
+    DG_CHECK((is_rejected<1u>(image, image_sz, header_field(offsetof(image::Header, role), image::ENCODE_ROLE))));
+
+    //the header is outside the checksum - its sections are bounds checked instead, even with the checksum off
+    auto tree_node_offs = offsetof(image::Header, tree_node);
+    DG_CHECK((is_rejected<1u>(image, image_sz, header_field(tree_node_offs + offsetof(image::Section, offs), image_sz), false)));
+    DG_CHECK((is_rejected<1u>(image, image_sz, header_field(tree_node_offs + offsetof(image::Section, offs), image::SECTION_ALIGNMENT + 8u), false)));
+    DG_CHECK((is_rejected<1u>(image, image_sz, header_field(tree_node_offs + offsetof(image::Section, sz), image_sz), false)));
+    DG_CHECK((is_rejected<1u>(image, image_sz, header_field(tree_node_offs + offsetof(image::Section, elem_sz), 1u), false)));
+    DG_CHECK((is_rejected<1u>(image, image_sz, header_field(offsetof(image::Header, canonical_max_length), constants::MAX_CODE_LENGTH + 1u), false)));
+
+    //tables are viewed in place, so the image itself must sit on a section boundary
+    auto misaligned = copy_image(image, image_sz, 16u);
+    DG_CHECK(test::throws<runtime_exception::CorruptedError>([&]{user_interface::spawn_fast_engine_view<1u>(misaligned.get() + 16u, image_sz);}));
+}
+
+auto leaf(unsigned char sym) -> std::unique_ptr<model::Node>{
+
+    auto rs     = std::make_unique<model::Node>();
+    rs->c[0]    = static_cast<char>(sym);
+
+    return rs;
+}
+
+//legacy trees are not length-limited - one too deep for MAX_CODE_LENGTH must be refused when the image is made
+void test_legacy_tree(){
+
+    auto caterpillar = leaf(255u);
+
+    for (size_t sym = 255u; sym-- != 0u;){
+        auto node   = std::make_unique<model::Node>();
+        node->l     = leaf(static_cast<unsigned char>(sym));
+        node->r     = std::move(caterpillar);
+        caterpillar = std::move(node);
+    }
+
+    DG_CHECK(test::throws<runtime_exception::CorruptedError>([&]{user_interface::spawn_fast_engine<1u>(caterpillar.get());}));
+
+    //pairing neighbours level by level gives every symbol an 8-bit code, well within the limit
+    auto level = std::vector<std::unique_ptr<model::Node>>{};
+
+    for (size_t sym = 0u; sym < constants::DICT_SIZE<1u>; ++sym){
+        level.push_back(leaf(static_cast<unsigned char>(sym)));
+    }
+
+    while (level.size() != 1u){
+        auto next = std::vector<std::unique_ptr<model::Node>>{};
+
+        for (size_t i = 0u; i < level.size(); i += 2u){
+            next.push_back(std::make_unique<model::Node>());
+            next.back()->l = std::move(level[i]);
+            next.back()->r = std::move(level[i + 1u]);
+        }
+
+        level = std::move(next);
+    }
+
+    auto gen        = std::mt19937{13u};
+    auto balanced   = user_interface::spawn_fast_engine<1u>(level.front().get());
+    check_same_engine(*balanced, *balanced, test::make_data(test::Shape::uniform, size_t{1} << 12, gen));
+
+    auto one_child  = std::make_unique<model::Node>();
+    one_child->l    = leaf(0u);
+    DG_CHECK(test::throws<runtime_exception::CorruptedError>([&]{user_interface::spawn_fast_engine<1u>(one_child.get());}));
+}
+
+int main(){
+
+    test_round_trip<1u>(test::Shape::skewed, false, 1u);
+    test_round_trip<1u>(test::Shape::sparse, true, 2u);
+    test_round_trip<2u>(test::Shape::skewed, false, 3u);
+    test_corruption();
+    test_legacy_tree();
+    std::puts("test_engine_image: ok");
+}
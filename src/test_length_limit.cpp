@@ -0,0 +1,136 @@
+#include "test.h"
+#include <algorithm>
+#include <cstring>
+
+//package-merge length limiting and the canonical decode of codes past the decode table
+
+using namespace dg::huffman_encoder;
+
+//fibonacci counts are the worst case for code length - unrestricted, symbol i sits i levels deep
+template <size_t ALPHABET_SIZE>
+auto fibonacci_counter() -> std::vector<size_t>{
+
+    auto rs = std::vector<size_t>(constants::DICT_SIZE<ALPHABET_SIZE>, size_t{1u});
+
+    for (size_t i = 2; i < std::min(rs.size(), size_t{80u}); ++i){
+        rs[i] = rs[i - 1] + rs[i - 2];
+    }
+
+    return rs;
+}
+
+//every symbol at least once, so the longest codes are on the wire
+auto all_symbols(std::mt19937& gen) -> std::string{
+
+    auto rs = test::make_data(test::Shape::skewed, size_t{1} << 14, gen);
+
+    for (size_t i = 0; i < 4u; ++i){
+        for (size_t sym = 0; sym < constants::DICT_SIZE<1u>; ++sym){
+            rs.push_back(static_cast<char>(sym));
+        }
+    }
+
+    std::shuffle(rs.begin(), rs.end(), gen);
+    return rs;
+}
+
+template <size_t ALPHABET_SIZE>
+void check_round_trip(const core::FastEngine<ALPHABET_SIZE>& engine, const std::string& data){
+
+    auto [enc, enc_sz]  = engine.encode(data.data(), data.size());
+    auto fast_dec       = std::string(constants::MAX_DECODING_SZ_PER_BYTE * enc_sz + 1u, '\0');
+    auto slow_dec       = std::string(constants::MAX_DECODING_SZ_PER_BYTE * enc_sz + 1u, '\0');
+    auto checked_dec    = std::string(data.size(), '\0');
+
+    auto [_, fast_last]             = engine.fast_decode_into(enc.get(), 0u, enc_sz * CHAR_BIT, fast_dec.data());
+    auto [__, slow_last]            = engine.decode_into(enc.get(), 0u, slow_dec.data());
+    auto [inp_last, checked_last]   = engine.checked_decode_into(enc.get(), enc_sz, checked_dec.data(), checked_dec.size());
+
+    DG_CHECK(enc_sz == engine.encoded_size(data.data(), data.size()));
+    DG_CHECK(std::string(fast_dec.data(), fast_last) == data);
+    DG_CHECK(std::string(slow_dec.data(), slow_last) == data);
+    DG_CHECK(inp_last == enc.get() + enc_sz);
+    DG_CHECK(std::string(checked_dec.data(), checked_last) == data);
+}
+
+void test_length_limit(){
+
+    auto counter = fibonacci_counter<1u>();
+
+    for (size_t max_code_length: {9u, 12u, 13u, 16u, 24u, 32u}){
+        auto tree = user_interface::build<1u>(counter, max_code_length);
+
+        DG_CHECK(make::max_depth(tree) <= max_code_length - 1u);
+        DG_CHECK(make::max_depth(make::to_delim_tree<1u>(tree, false)) <= max_code_length);
+        DG_CHECK(make::max_depth(make::to_delim_tree<1u>(tree, true)) <= max_code_length);
+    }
+
+    auto wide_tree = user_interface::build<2u>(fibonacci_counter<2u>(), 17u);
+    DG_CHECK(make::max_depth(wide_tree) <= 16u);
+    DG_CHECK(make::max_depth(make::to_delim_tree<2u>(wide_tree, false)) <= 17u);
+}
+
+//a limit the huffman code already meets must not change it
+void test_limit_is_noop_when_met(){
+
+    auto gen        = std::mt19937{11u};
+    auto train      = test::make_data(test::Shape::skewed, size_t{1} << 16, gen);
+    auto counter    = user_interface::count<1u>(train.data(), train.size());
+    auto loose_tree = user_interface::build<1u>(counter, constants::MAX_CODE_LENGTH);
+    auto loose      = user_interface::to_compact_model<1u>(loose_tree);
+    auto tight      = user_interface::to_compact_model<1u>(user_interface::build<1u>(counter, constants::DEFAULT_MAX_CODE_LENGTH));
+
+    DG_CHECK(make::max_depth(loose_tree) < constants::DEFAULT_MAX_CODE_LENGTH - 1u);
+    DG_CHECK(tight.encoding == loose.encoding && tight.payload == loose.payload);
+}
+
+//codes from 9 up to 32 bits, most of them past DECODE_TABLE_BIT_SIZE, so decode leaves the table for the canonical read
+void test_canonical_decode(){
+
+    auto gen        = std::mt19937{7u};
+    auto counter    = fibonacci_counter<1u>();
+
+    for (size_t max_code_length: {9u, 13u, 16u, 24u, 32u}){
+        auto tree = user_interface::build<1u>(counter, max_code_length);
+
+        for (bool rle_escape: {false, true}){
+            auto engine = user_interface::spawn_fast_engine<1u>(tree, rle_escape);
+
+            check_round_trip(*engine, all_symbols(gen));
+            check_round_trip(*engine, std::string{});
+            check_round_trip(*engine, std::string(1u, '\xff'));
+        }
+    }
+}
+
+//the compact model is the canonical form - it round trips exactly and spawns an engine that writes the same bits
+void test_compact_model(){
+
+    auto gen = std::mt19937{5u};
+
+    for (auto shape: {test::Shape::uniform, test::Shape::skewed, test::Shape::sparse}){
+        auto tree       = test::make_model<1u>(shape, gen);
+        auto compact    = user_interface::to_compact_model<1u>(tree);
+        auto [buf, sz]  = dg::compact_serializer::serialize(compact);
+        auto restored   = dg::compact_serializer::deserialize<model::CodeLengthModel>(buf.get(), sz);
+        auto again      = user_interface::to_compact_model<1u>(user_interface::from_compact_model<1u>(restored));
+        auto data       = test::make_data(shape, size_t{1} << 15, gen);
+
+        DG_CHECK(again.encoding == compact.encoding && again.payload == compact.payload);
+
+        auto [lhs, lhs_sz] = user_interface::spawn_fast_engine<1u>(tree)->encode(data.data(), data.size());
+        auto [rhs, rhs_sz] = user_interface::spawn_fast_engine<1u>(restored)->encode(data.data(), data.size());
+
+        DG_CHECK(lhs_sz == rhs_sz && std::memcmp(lhs.get(), rhs.get(), lhs_sz) == 0);
+        check_round_trip(*user_interface::spawn_fast_engine<1u>(restored), data);
+    }
+}
+
+int main(){
+
+    test_length_limit();
+    test_limit_is_noop_when_met();
+    test_canonical_decode();
+    test_compact_model();
+    std::puts("test_length_limit: ok");
+}
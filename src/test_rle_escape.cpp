@@ -0,0 +1,173 @@
+#include "test.h"
+#include <algorithm>
+#include <cstring>
+
+//the rle escape - runs around RLE_MIN_REPEAT_SZ, zero pages and repeated 16-bit symbols through every encode and decode path
+
+using namespace dg::huffman_encoder;
+
+auto run_data(size_t sz, std::mt19937& gen) -> std::string{
+
+    auto rs = std::string{};
+
+    while (rs.size() < sz){
+        auto sym = static_cast<char>(gen());
+
+        switch (gen() % 5u){
+            case 0:
+                rs.append(4096u, '\0');
+                break;
+            case 1:
+                rs.append(constants::RLE_MIN_REPEAT_SZ - 1u + gen() % 3u, sym);
+                break;
+            case 2:
+                rs.append(gen() % 700u, sym);
+                break;
+            case 3:
+                for (size_t i = 0u, pair_sz = gen() % 300u; i < pair_sz; ++i){
+                    rs += sym;
+                    rs += 'x';
+                }
+                break;
+            default:
+                rs += test::make_data(test::Shape::skewed, gen() % 64u, gen);
+                break;
+        }
+    }
+
+    rs.resize(sz);
+    return rs;
+}
+
+template <size_t ALPHABET_SIZE>
+void check_round_trip(const core::FastEngine<ALPHABET_SIZE>& engine, const std::string& data){
+
+    auto [enc, enc_sz]  = engine.encode(data.data(), data.size());
+    auto padded         = std::vector<char>(enc.get(), enc.get() + enc_sz);
+    auto stats          = stats::DecodeStats{};
+    padded.resize(enc_sz + sizeof(types::bit_container_type));
+
+    //runs break the MAX_DECODING_SZ_PER_BYTE bound, so the unchecked decoders get the decoded size plus slack for whole-entry stores
+    auto fast_dec       = std::vector<char>(data.size() + constants::MAX_DECODING_SZ_PER_BYTE);
+    auto [_, fast_last] = engine.fast_decode_into(padded.data(), 0u, enc_sz * CHAR_BIT, fast_dec.data(), stats);
+    DG_CHECK(std::string(fast_dec.data(), fast_last) == data);
+    DG_CHECK(stats.symbol_count * ALPHABET_SIZE + stats.trailing_byte_sz == data.size());
+
+    auto slow_dec           = std::vector<char>(data.size() + constants::MAX_DECODING_SZ_PER_BYTE);
+    auto [__, slow_last]    = engine.decode_into(padded.data(), 0u, slow_dec.data());
+    DG_CHECK(std::string(slow_dec.data(), slow_last) == data);
+
+    auto checked_dec                = std::vector<char>(data.size());
+    auto [inp_last, checked_last]   = engine.checked_decode_into(enc.get(), enc_sz, checked_dec.data(), checked_dec.size());
+    DG_CHECK(inp_last == enc.get() + enc_sz && checked_last == checked_dec.data() + checked_dec.size());
+    DG_CHECK(std::equal(checked_dec.begin(), checked_dec.end(), data.begin()));
+
+    if (!data.empty()){
+        auto short_dec = std::vector<char>(data.size() - 1u);
+        DG_CHECK(test::throws<runtime_exception::OutputOverflowError>([&]{engine.checked_decode_into(enc.get(), enc_sz, short_dec.data(), short_dec.size());}));
+    }
+
+    auto il_enc                     = std::vector<char>(interleaved::max_encoding_size(data.size(), constants::INTERLEAVED_LANE_SZ));
+    auto il_dec                     = std::vector<char>(data.size() + constants::MAX_DECODING_SZ_PER_BYTE);
+    auto il_last                    = engine.interleaved_encode_into(data.data(), data.size(), il_enc.data());
+    auto [il_inp_last, il_op_last]  = engine.interleaved_decode_into(il_enc.data(), il_dec.data());
+    DG_CHECK(il_inp_last == il_last);
+    DG_CHECK(std::string(il_dec.data(), il_op_last) == data);
+}
+
+//the stream classes must write and read the same bits as the one-shot engine
+template <size_t ALPHABET_SIZE>
+void check_stream(const core::FastEngine<ALPHABET_SIZE>& engine, const std::string& data, size_t max_chunk_sz, std::mt19937& gen){
+
+    auto encoder        = user_interface::spawn_stream_encoder(engine);
+    auto decoder        = user_interface::spawn_stream_decoder(engine);
+    auto [ref, ref_sz]  = engine.encode(data.data(), data.size());
+    auto window         = std::vector<char>(max_chunk_sz + 1u);
+    auto enc            = std::string{};
+    auto dec            = std::string{};
+
+    for (size_t offs = 0u; offs != data.size();){
+        auto inp_sz         = std::min(data.size() - offs, static_cast<size_t>(gen() % (max_chunk_sz + 1u)));
+        auto [used, made]   = encoder->encode(data.data() + offs, inp_sz, window.data(), gen() % (max_chunk_sz + 1u));
+        enc.append(window.data(), made);
+        offs += used;
+    }
+
+    for (auto is_done = false; !is_done;){
+        auto [made, done]   = encoder->finish(window.data(), gen() % (max_chunk_sz + 2u));
+        enc.append(window.data(), made);
+        is_done = done;
+    }
+
+    DG_CHECK(enc == std::string(ref.get(), ref_sz));
+
+    for (size_t offs = 0u; !decoder->is_done();){
+        auto chunk          = std::vector<char>(enc.begin() + offs, enc.begin() + offs + std::min(enc.size() - offs, static_cast<size_t>(gen() % (max_chunk_sz + 1u))));
+        auto [used, made]   = decoder->decode(chunk.data(), chunk.size(), window.data(), gen() % (max_chunk_sz + 1u));
+        dec.append(window.data(), made);
+        offs += used;
+    }
+
+    DG_CHECK(dec == data);
+}
+
+template <size_t ALPHABET_SIZE>
+void test_rle_escape(uint32_t seed){
+
+    auto gen    = std::mt19937{seed};
+    auto train  = run_data(size_t{1} << 18, gen);
+    auto tree   = user_interface::build<ALPHABET_SIZE>(user_interface::count<ALPHABET_SIZE>(train.data(), train.size()));
+    auto engine = user_interface::spawn_fast_engine<ALPHABET_SIZE>(tree, true);
+    auto plain  = user_interface::spawn_fast_engine<ALPHABET_SIZE>(tree, false);
+
+    DG_CHECK(engine->has_escape() && !plain->has_escape());
+
+    //a zero page is a handful of bytes, where the plain engine spends at least a bit per symbol
+    auto zero_page = std::string(size_t{1} << 20, '\0');
+    DG_CHECK(engine->encoded_size(zero_page.data(), zero_page.size()) < 64u);
+    DG_CHECK(plain->encoded_size(zero_page.data(), zero_page.size()) >= zero_page.size() / ALPHABET_SIZE / CHAR_BIT);
+    check_round_trip(*engine, zero_page);
+
+    for (size_t repeat_sz = 1u; repeat_sz <= constants::RLE_MIN_REPEAT_SZ * 2u + 1u; ++repeat_sz){
+        check_round_trip(*engine, std::string(repeat_sz * ALPHABET_SIZE, 'a') + "b");
+        check_round_trip(*engine, "b" + std::string(repeat_sz * ALPHABET_SIZE, 'a'));
+    }
+
+    for (size_t sz: {size_t{0u}, size_t{1u}, size_t{3u}, size_t{4097u}, size_t{100001u}}){
+        auto data = run_data(sz, gen);
+        check_round_trip(*engine, data);
+
+        for (size_t max_chunk_sz: {size_t{1u}, size_t{7u}, size_t{300u}, size_t{1} << 16}){
+            check_stream(*engine, data, max_chunk_sz, gen);
+        }
+    }
+
+    //a message cut inside a run's repeat count, or anywhere else, is corrupted - flipped bits must stay within bounds
+    auto data           = run_data(20000u, gen);
+    auto [enc, enc_sz]  = engine->encode(data.data(), data.size());
+    auto op             = std::vector<char>(data.size());
+
+    for (size_t cut = 1u; cut <= std::min(enc_sz, size_t{16u}); ++cut){
+        auto truncated = std::vector<char>(enc.get(), enc.get() + enc_sz - cut);
+        DG_CHECK(test::throws<runtime_exception::CorruptedError>([&]{engine->checked_decode_into(truncated.data(), truncated.size(), op.data(), op.size());}));
+    }
+
+    for (size_t i = 0u; i < 256u; ++i){
+        auto flipped = std::vector<char>(enc.get(), enc.get() + enc_sz);
+        flipped[gen() % enc_sz] ^= static_cast<char>(1u << (gen() % CHAR_BIT));
+
+        try{
+            auto [inp_last, op_last] = engine->checked_decode_into(flipped.data(), flipped.size(), op.data(), op.size());
+            DG_CHECK(inp_last <= flipped.data() + flipped.size() && op_last <= op.data() + op.size());
+        } catch (const runtime_exception::CorruptedError&){
+        } catch (const runtime_exception::OutputOverflowError&){
+        }
+    }
+}
+
+int main(){
+
+    test_rle_escape<1u>(1u);
+    test_rle_escape<2u>(2u);
+    std::puts("test_rle_escape: ok");
+}
@@ -0,0 +1,137 @@
+#include "test.h"
+#include <algorithm>
+#include <cstring>
+
+//frame blocks that would not shrink are stored raw - incompressible input costs only the frame header and decodes with memcpy
+
+using namespace dg::huffman_encoder;
+
+static inline constexpr size_t BLOCK_SZ = 4096;
+
+//random blocks at even indices, skewed ones at odd indices, and a random partial block at the end
+auto mixed_data(size_t blk_count, std::mt19937& gen) -> std::string{
+
+    auto rs = std::string{};
+
+    for (size_t i = 0u; i < blk_count; ++i){
+        rs += test::make_data(i % 2u == 0u ? test::Shape::uniform : test::Shape::skewed, BLOCK_SZ, gen);
+    }
+
+    return rs + test::make_data(test::Shape::uniform, BLOCK_SZ / 3u * 2u, gen);
+}
+
+auto read_u64(const char * buf) -> uint64_t{
+
+    auto rs = uint64_t{};
+    dg::compact_serializer::core::deserialize(buf, rs);
+
+    return rs;
+}
+
+template <class Engine>
+auto is_refused(const Engine& engine, const std::vector<char>& enc, size_t op_cap) -> bool{
+
+    auto op = std::vector<char>(op_cap);
+
+    try{
+        engine.checked_decode_into(enc.data(), enc.size(), op.data(), op.size());
+    } catch (const runtime_exception::CorruptedError&){
+        return true;
+    } catch (const runtime_exception::OutputOverflowError&){
+        return true;
+    }
+
+    return false;
+}
+
+template <size_t ALPHABET_SIZE>
+void test_frame(uint32_t seed){
+
+    auto gen        = std::mt19937{seed};
+    auto engine     = user_interface::spawn_frame_engine(user_interface::spawn_fast_engine<ALPHABET_SIZE>(test::make_model<ALPHABET_SIZE>(test::Shape::skewed, gen)), BLOCK_SZ, 3u);
+    auto data       = mixed_data(8u, gen);
+    auto blk_count  = frame::block_count(data.size(), BLOCK_SZ);
+    auto enc        = std::vector<char>(frame::max_encoding_size(data.size(), BLOCK_SZ));
+    enc.resize(std::distance(enc.data(), engine->encode_into(data.data(), data.size(), enc.data())));
+
+    //each random block is stored verbatim at its offset, each skewed one is coded smaller
+    auto blk_offs = frame::header_size(blk_count);
+
+    for (size_t i = 0u; i < blk_count; ++i){
+        auto blk_inp_sz = std::min(BLOCK_SZ, data.size() - i * BLOCK_SZ);
+        auto blk_bytes  = read_u64(enc.data() + sizeof(uint64_t) * (2u + i));
+
+        if (i % 2u == 0u){
+            DG_CHECK(blk_bytes == blk_inp_sz);
+            DG_CHECK(std::memcmp(enc.data() + blk_offs, data.data() + i * BLOCK_SZ, blk_inp_sz) == 0);
+        } else{
+            DG_CHECK(blk_bytes < blk_inp_sz);
+        }
+
+        blk_offs += blk_bytes;
+    }
+
+    DG_CHECK(blk_offs == enc.size());
+
+    auto stats  = stats::DecodeStats{};
+    auto dec    = std::vector<char>(data.size());
+    auto [inp_last, op_last] = engine->decode_into(enc.data(), dec.data(), stats);
+
+    DG_CHECK(inp_last == enc.data() + enc.size() && op_last == dec.data() + dec.size());
+    DG_CHECK(std::equal(dec.begin(), dec.end(), data.begin()));
+    DG_CHECK(stats.stored_block_count == blk_count / 2u + 1u);
+    DG_CHECK(stats.stored_byte_sz == BLOCK_SZ * (blk_count / 2u) + BLOCK_SZ / 3u * 2u);
+
+    auto checked_dec = std::vector<char>(data.size());
+    engine->checked_decode_into(enc.data(), enc.size(), checked_dec.data(), checked_dec.size());
+    DG_CHECK(checked_dec == dec);
+
+    //all-random input comes out at exactly max_encoding_size
+    auto noise      = test::make_data(test::Shape::uniform, BLOCK_SZ * 5u + 1u, gen);
+    auto noise_enc  = std::vector<char>(frame::max_encoding_size(noise.size(), BLOCK_SZ));
+    DG_CHECK(engine->encode_into(noise.data(), noise.size(), noise_enc.data()) == noise_enc.data() + noise_enc.size());
+
+    //a stored block whose length no longer matches its decoded size is taken for a coded one - it must not decode cleanly
+    auto shrunk = enc;
+    auto first  = read_u64(enc.data() + sizeof(uint64_t) * 2u) - 1u;
+    auto second = read_u64(enc.data() + sizeof(uint64_t) * 3u) + 1u;
+    std::memcpy(shrunk.data() + sizeof(uint64_t) * 2u, &first, sizeof(uint64_t));
+    std::memcpy(shrunk.data() + sizeof(uint64_t) * 3u, &second, sizeof(uint64_t));
+    DG_CHECK(is_refused(*engine, shrunk, data.size()));
+}
+
+void test_adaptive_frame(){
+
+    auto gen    = std::mt19937{21u};
+    auto engine = user_interface::spawn_adaptive_frame_engine(user_interface::spawn_fast_engine<1u>(test::make_model<1u>(test::Shape::skewed, gen)),
+                                                              user_interface::spawn_fast_engine<2u>(test::make_model<2u>(test::Shape::skewed, gen)),
+                                                              BLOCK_SZ, 3u);
+    auto data   = mixed_data(8u, gen);
+    auto enc    = std::vector<char>(frame::max_adaptive_encoding_size(data.size(), BLOCK_SZ));
+    enc.resize(std::distance(enc.data(), engine->encode_into(data.data(), data.size(), enc.data())));
+
+    auto stats  = stats::DecodeStats{};
+    auto dec    = std::vector<char>(data.size());
+    auto [inp_last, op_last] = engine->decode_into(enc.data(), dec.data(), stats);
+
+    DG_CHECK(inp_last == enc.data() + enc.size() && op_last == dec.data() + dec.size());
+    DG_CHECK(std::equal(dec.begin(), dec.end(), data.begin()));
+    DG_CHECK(stats.stored_block_count == 5u);
+    DG_CHECK(stats.stored_byte_sz == BLOCK_SZ * 4u + BLOCK_SZ / 3u * 2u);
+
+    auto checked_dec = std::vector<char>(data.size());
+    engine->checked_decode_into(enc.data(), enc.size(), checked_dec.data(), checked_dec.size());
+    DG_CHECK(checked_dec == dec);
+
+    auto noise      = test::make_data(test::Shape::uniform, BLOCK_SZ * 5u + 2u, gen);
+    auto noise_enc  = std::vector<char>(frame::max_adaptive_encoding_size(noise.size(), BLOCK_SZ));
+    DG_CHECK(engine->encode_into(noise.data(), noise.size(), noise_enc.data()) == noise_enc.data() + noise_enc.size());
+}
+
+int main(){
+
+    test_frame<1u>(1u);
+    test_frame<2u>(2u);
+    test_adaptive_frame();
+    std::puts("test_stored_block: ok");
+}
@@ -0,0 +1,73 @@
+#include "test.h"
+
+//StreamDecoder over random input chunks and output windows - each chunk is its own exact-size heap buffer, so under
+//-fsanitize=address a read past the chunk fails the run
+
+using namespace dg::huffman_encoder;
+
+//returns {decoded, consumed} - stops once the decoder is done or has made no progress for 64 calls in a row
+template <size_t ALPHABET_SIZE>
+auto stream_decode(core::StreamDecoder<ALPHABET_SIZE>& decoder, const std::string& enc, size_t max_inp_sz, size_t max_op_sz, std::mt19937& gen) -> std::pair<std::string, size_t>{
+
+    auto rs         = std::string{};
+    auto window     = std::vector<char>(max_op_sz);
+    auto inp_offs   = size_t{0u};
+    auto idle_sz    = size_t{0u};
+
+    while (!decoder.is_done() && idle_sz < 64u){
+        auto inp_sz         = std::min(enc.size() - inp_offs, static_cast<size_t>(gen() % (max_inp_sz + 1u)));
+        auto op_sz          = static_cast<size_t>(gen() % (max_op_sz + 1u));
+        auto chunk          = std::vector<char>(enc.begin() + inp_offs, enc.begin() + inp_offs + inp_sz);
+        auto [used, made]   = decoder.decode(chunk.data(), chunk.size(), window.data(), op_sz);
+
+        DG_CHECK(used <= inp_sz && made <= op_sz);
+        rs.append(window.data(), made);
+        inp_offs    += used;
+        idle_sz     = (used == 0u && made == 0u) ? idle_sz + 1u : 0u;
+    }
+
+    return {rs, inp_offs};
+}
+
+template <size_t ALPHABET_SIZE>
+void test_stream_decoder(test::Shape shape, size_t max_code_length, uint32_t seed){
+
+    auto gen        = std::mt19937{seed};
+    auto engine     = user_interface::spawn_fast_engine<ALPHABET_SIZE>(test::make_model<ALPHABET_SIZE>(shape, gen, max_code_length));
+    auto decoder    = user_interface::spawn_stream_decoder(*engine);
+
+    for (size_t sz: {size_t{0u}, size_t{1u}, size_t{2u}, size_t{3u}, size_t{63u}, size_t{1000u}, size_t{40001u}}){
+        auto data           = test::make_data(shape, sz, gen);
+        auto [enc, enc_sz]  = engine->encode(data.data(), data.size());
+        auto message        = std::string(enc.get(), enc_sz);
+
+        //the next message follows on the wire - the decoder must stop at the end of this one
+        for (auto [max_inp_sz, max_op_sz]: {std::pair<size_t, size_t>{1u, 1u}, {37u, 5u}, {4096u, 3u}, {3u, 4096u}, {size_t{1} << 16, size_t{1} << 16}}){
+            auto [dec, used] = stream_decode(*decoder, message + "next message", max_inp_sz, max_op_sz, gen);
+
+            DG_CHECK(decoder->is_done());
+            DG_CHECK(dec == data);
+            DG_CHECK(used == message.size());
+            decoder->reset();
+        }
+
+        //a message cut anywhere never completes, and what comes out is a prefix of the data
+        for (size_t cut = 1u; cut <= std::min(message.size(), size_t{8u}); ++cut){
+            auto [dec, used] = stream_decode(*decoder, message.substr(0u, message.size() - cut), 37u, 64u, gen);
+
+            DG_CHECK(!decoder->is_done());
+            DG_CHECK(dec.size() <= data.size() && data.compare(0u, dec.size(), dec) == 0);
+            decoder->reset();
+        }
+    }
+}
+
+int main(){
+
+    test_stream_decoder<1u>(test::Shape::skewed, constants::DEFAULT_MAX_CODE_LENGTH, 1u);
+    test_stream_decoder<1u>(test::Shape::uniform, constants::DEFAULT_MAX_CODE_LENGTH, 2u);
+    test_stream_decoder<1u>(test::Shape::skewed, constants::MAX_CODE_LENGTH, 3u);
+    test_stream_decoder<2u>(test::Shape::skewed, constants::DEFAULT_MAX_CODE_LENGTH, 4u);
+    test_stream_decoder<2u>(test::Shape::sparse, constants::DEFAULT_MAX_CODE_LENGTH, 5u);
+    std::puts("test_stream_decoder: ok");
+}
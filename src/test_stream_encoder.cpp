@@ -0,0 +1,65 @@
+#include "test.h"
+
+//StreamEncoder over random input chunks and output windows, zero-sized ones included, against FastEngine::encode in one call
+
+using namespace dg::huffman_encoder;
+
+template <size_t ALPHABET_SIZE>
+auto stream_encode(core::StreamEncoder<ALPHABET_SIZE>& encoder, const std::string& data, size_t max_inp_sz, size_t max_op_sz, std::mt19937& gen) -> std::string{
+
+    auto rs         = std::string{};
+    auto window     = std::vector<char>(max_op_sz + 1u);
+    auto inp_offs   = size_t{0u};
+
+    while (inp_offs != data.size()){
+        auto inp_sz         = std::min(data.size() - inp_offs, static_cast<size_t>(gen() % (max_inp_sz + 1u)));
+        auto op_sz          = static_cast<size_t>(gen() % (max_op_sz + 1u));
+        auto [used, made]   = encoder.encode(data.data() + inp_offs, inp_sz, window.data(), op_sz);
+
+        DG_CHECK(used <= inp_sz && made <= op_sz);
+        rs.append(window.data(), made);
+        inp_offs += used;
+    }
+
+    while (true){
+        auto op_sz              = static_cast<size_t>(gen() % (max_op_sz + 2u));
+        auto [made, is_done]    = encoder.finish(window.data(), op_sz);
+
+        DG_CHECK(made <= op_sz);
+        rs.append(window.data(), made);
+
+        if (is_done){
+            return rs;
+        }
+    }
+}
+
+template <size_t ALPHABET_SIZE>
+void test_stream_encoder(test::Shape shape, uint32_t seed){
+
+    auto gen        = std::mt19937{seed};
+    auto engine     = user_interface::spawn_fast_engine<ALPHABET_SIZE>(test::make_model<ALPHABET_SIZE>(shape, gen));
+    auto encoder    = user_interface::spawn_stream_encoder(*engine);
+
+    //odd sizes leave a 16-bit engine a trailing byte to carry and flush
+    for (size_t sz: {size_t{0u}, size_t{1u}, size_t{2u}, size_t{3u}, size_t{63u}, size_t{1000u}, size_t{40001u}}){
+        auto data           = test::make_data(shape, sz, gen);
+        auto [ref, ref_sz]  = engine->encode(data.data(), data.size());
+        auto expected       = std::string(ref.get(), ref_sz);
+
+        //the encoder is reset and reused - a stale carry or staged byte would show up in the next message
+        for (auto [max_inp_sz, max_op_sz]: {std::pair<size_t, size_t>{1u, 1u}, {37u, 5u}, {4096u, 3u}, {3u, 4096u}, {size_t{1} << 16, size_t{1} << 16}}){
+            DG_CHECK(stream_encode(*encoder, data, max_inp_sz, max_op_sz, gen) == expected);
+            encoder->reset();
+        }
+    }
+}
+
+int main(){
+
+    test_stream_encoder<1u>(test::Shape::skewed, 1u);
+    test_stream_encoder<1u>(test::Shape::uniform, 2u);
+    test_stream_encoder<2u>(test::Shape::skewed, 3u);
+    test_stream_encoder<2u>(test::Shape::sparse, 4u);
+    std::puts("test_stream_encoder: ok");
+}
@@ -0,0 +1,198 @@
+#ifndef __DG_THREAD_POOL__
+#define __DG_THREAD_POOL__
+
+#include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <optional>
+#include <exception>
+#include <utility>
+
+namespace dg::thread_pool{
+
+    class WorkStealingPool{
+
+        private:
+
+            struct WorkQueue{
+                std::mutex mtx;
+                std::deque<size_t> task;
+            };
+
+            std::vector<std::unique_ptr<WorkQueue>> queue; //one per worker, the last one belongs to the calling thread
+            std::vector<std::thread> workers;
+            std::mutex mtx;
+            std::mutex submit_mtx;
+            std::condition_variable job_cv;
+            std::condition_variable done_cv;
+            const std::function<void(size_t)> * job;
+            std::exception_ptr job_err; //first exception thrown by a task of the current job
+            size_t generation;
+            size_t remaining;
+            bool is_stopped;
+
+        public:
+
+            WorkStealingPool(size_t thread_sz): queue(),
+                                                workers(),
+                                                mtx(),
+                                                submit_mtx(),
+                                                job_cv(),
+                                                done_cv(),
+                                                job(nullptr),
+                                                job_err(nullptr),
+                                                generation(0u),
+                                                remaining(0u),
+                                                is_stopped(false){
+
+                for (size_t i = 0; i < thread_sz + 1; ++i){
+                    this->queue.push_back(std::make_unique<WorkQueue>());
+                }
+
+                for (size_t i = 0; i < thread_sz; ++i){
+                    this->workers.emplace_back([this, i]{this->worker_loop(i);});
+                }
+            }
+
+            WorkStealingPool(const WorkStealingPool&) = delete;
+            WorkStealingPool& operator =(const WorkStealingPool&) = delete;
+
+            ~WorkStealingPool() noexcept{
+
+                {
+                    auto lck_grd = std::lock_guard<std::mutex>(this->mtx);
+                    this->is_stopped = true;
+                }
+
+                this->job_cv.notify_all();
+
+                for (auto& worker: this->workers){
+                    worker.join();
+                }
+            }
+
+            auto size() const noexcept -> size_t{
+
+                return this->queue.size();
+            }
+
+            //runs task(i) for every i in [0, sz) and returns once all of them are done - the calling thread participates
+            //a throwing task does not stop the others, the first exception is rethrown here once every task has finished
+            void parallel_for(size_t sz, const std::function<void(size_t)>& task){
+
+                if (sz == 0u){
+                    return;
+                }
+
+                auto submit_grd = std::lock_guard<std::mutex>(this->submit_mtx);
+
+                {
+                    auto lck_grd        = std::lock_guard<std::mutex>(this->mtx);
+                    this->job           = &task;
+                    this->remaining     = sz;
+                    this->generation    += 1;
+                }
+
+                for (size_t i = 0; i < sz; ++i){
+                    auto& q         = *this->queue[i % this->queue.size()];
+                    auto lck_grd    = std::lock_guard<std::mutex>(q.mtx);
+                    q.task.push_back(i);
+                }
+
+                this->job_cv.notify_all();
+                this->work(this->queue.size() - 1);
+
+                auto lck_grd    = std::unique_lock<std::mutex>(this->mtx);
+                this->done_cv.wait(lck_grd, [this]{return this->remaining == 0u;});
+                this->job       = nullptr;
+
+                if (auto err = std::exchange(this->job_err, nullptr)){
+                    std::rethrow_exception(err);
+                }
+            }
+
+        private:
+
+            auto pop(size_t idx) -> std::optional<size_t>{
+
+                {
+                    auto& q         = *this->queue[idx];
+                    auto lck_grd    = std::lock_guard<std::mutex>(q.mtx);
+
+                    if (!q.task.empty()){
+                        auto rs = q.task.front();
+                        q.task.pop_front();
+                        return rs;
+                    }
+                }
+
+                for (size_t i = 1; i < this->queue.size(); ++i){
+                    auto& q         = *this->queue[(idx + i) % this->queue.size()];
+                    auto lck_grd    = std::lock_guard<std::mutex>(q.mtx);
+
+                    if (!q.task.empty()){
+                        auto rs = q.task.back();
+                        q.task.pop_back();
+                        return rs;
+                    }
+                }
+
+                return std::nullopt;
+            }
+
+            void work(size_t idx){
+
+                while (true){
+                    auto task_idx = this->pop(idx);
+
+                    if (!task_idx){
+                        return;
+                    }
+
+                    auto err = std::exception_ptr{};
+
+                    try{
+                        (*this->job)(*task_idx);
+                    } catch (...){
+                        err = std::current_exception();
+                    }
+
+                    auto lck_grd = std::lock_guard<std::mutex>(this->mtx);
+
+                    if (err && !this->job_err){
+                        this->job_err = std::move(err);
+                    }
+
+                    if (--this->remaining == 0u){
+                        this->done_cv.notify_all();
+                    }
+                }
+            }
+
+            void worker_loop(size_t idx){
+
+                auto seen = size_t{0u};
+
+                while (true){
+                    {
+                        auto lck_grd = std::unique_lock<std::mutex>(this->mtx);
+                        this->job_cv.wait(lck_grd, [&]{return this->is_stopped || this->generation != seen;});
+
+                        if (this->is_stopped){
+                            return;
+                        }
+
+                        seen = this->generation;
+                    }
+
+                    this->work(idx);
+                }
+            }
+    };
+}
+
+#endif